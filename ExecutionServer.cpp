@@ -0,0 +1,218 @@
+#include "ExecutionServer.hpp"
+
+#include <Tape.hpp>
+#include <TuringMachine.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+static constexpr char FieldSeparator = '\t';
+
+static bool loadSourceCode(const std::string &path, std::string &source_code)
+{
+	std::ifstream source_code_file(path, std::ios::binary);
+	if (!source_code_file.is_open())
+		return false;
+
+	source_code.assign(std::istreambuf_iterator<char>(source_code_file), std::istreambuf_iterator<char>());
+	source_code += '\n';
+	return true;
+}
+
+bool ExecutionServer::parseJob(const std::string &request, Job &job, std::string &error_description)
+{
+	std::vector<std::string> fields;
+	for (size_t field_begin = 0;;)
+	{
+		size_t field_end = request.find(FieldSeparator, field_begin);
+		fields.push_back(request.substr(field_begin, field_end - field_begin));
+		if (field_end == std::string::npos)
+			break;
+
+		field_begin = field_end + 1;
+	}
+
+	job.id = fields[0];
+	if (fields.size() < 5 || fields.size() > 6)
+	{
+		error_description = "Request error: expected 5 or 6 tab-separated fields, got " + std::to_string(fields.size());
+		return false;
+	}
+
+	if (fields[3].size() != 1)
+	{
+		error_description = "Request error: default tape symbol must be exactly one symbol";
+		return false;
+	}
+
+	size_t parsed_size = 0;
+	try
+	{
+		job.iterations_limit = std::stoull(fields[4], &parsed_size);
+	}
+	catch (const std::exception &)
+	{
+		parsed_size = 0;
+	}
+
+	if (parsed_size == 0 || parsed_size != fields[4].size() || fields[4][0] == '-')
+	{
+		error_description = "Request error: \"" + fields[4] + "\" is not a valid iterations limit";
+		return false;
+	}
+
+	job.program_path = fields[1];
+	job.begin_state_name = fields[2];
+	job.default_tape_symbol = fields[3][0];
+	job.tape_initial_data = fields.size() == 6 ? fields[5] : "";
+
+	return true;
+}
+
+/*
+ * Must be called with locked cache
+ */
+ExecutionServer::ProgramPtr ExecutionServer::findCachedProgram(uint64_t program_hash, const std::string &source_code, const std::string &begin_state_name) const
+{
+	auto [begin, end] = programs_cache.equal_range(program_hash);
+	for (auto it = begin; it != end; ++it)
+	{
+		if (it->second.source_code == source_code && it->second.begin_state_name == begin_state_name)
+			return it->second.program;
+	}
+
+	return nullptr;
+}
+
+ExecutionServer::ProgramPtr ExecutionServer::getProgram(const Job &job, std::string &error_description)
+{
+	std::string source_code;
+	if (!loadSourceCode(job.program_path, source_code))
+	{
+		error_description = "Unable to load program source code from \"" + job.program_path + "\"";
+		return nullptr;
+	}
+
+	uint64_t program_hash = TM::TuringProgram::hashSource(source_code, job.begin_state_name);
+	{
+		std::lock_guard<std::mutex> lock(programs_cache_mutex);
+		if (ProgramPtr program = findCachedProgram(program_hash, source_code, job.begin_state_name))
+			return program;
+	}
+
+	// Compilation is performed without lock, so other workers aren't blocked by it.
+	// If several workers compile the same program simultaneously, first inserted one wins.
+	auto program = std::make_shared<TM::TuringProgram>();
+	TM::ErrorInfo error_info;
+	if (!program->compile(source_code, error_info, job.begin_state_name))
+	{
+		error_description = error_info.description;
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(programs_cache_mutex);
+	if (ProgramPtr cached_program = findCachedProgram(program_hash, source_code, job.begin_state_name))
+		return cached_program;
+
+	programs_cache.insert({ program_hash, CachedProgram{ std::move(source_code), job.begin_state_name, program } });
+	return program;
+}
+
+void ExecutionServer::processJob(const Job &job)
+{
+	std::string error_description;
+	ProgramPtr program = getProgram(job, error_description);
+	if (!program)
+	{
+		writeResponse(job.id, false, error_description);
+		return;
+	}
+
+	TM::Tape tape(job.default_tape_symbol, job.tape_initial_data, 0, max_tape_bytes);
+	TM::TuringMachine turing_machine(*program, tape);
+
+	TM::ExecutionLimits job_limits = limits;
+	if (job_timeout.count() != 0)
+		job_limits.deadline = TM::ExecutionLimits::Clock::now() + job_timeout;
+	turing_machine.setLimits(job_limits);
+	if (!turing_machine.execute(error_description, job.iterations_limit))
+	{
+		writeResponse(job.id, false, error_description);
+		return;
+	}
+
+	tape.trimRedundantSpaces();
+	writeResponse(job.id, true, tape.getString());
+}
+
+void ExecutionServer::workerLoop()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(jobs_queue_mutex);
+			jobs_queue_condition.wait(lock, [this]() { return !jobs_queue.empty() || input_finished; });
+			if (jobs_queue.empty())
+				return;
+
+			job = std::move(jobs_queue.front());
+			jobs_queue.pop_front();
+		}
+		jobs_queue_space_condition.notify_one();
+
+		processJob(job);
+	}
+}
+
+void ExecutionServer::writeResponse(const std::string &job_id, bool success, const std::string &message)
+{
+	std::lock_guard<std::mutex> lock(output_mutex);
+	output << job_id << FieldSeparator << (success ? "ok" : "error") << FieldSeparator << message << '\n';
+	output.flush();
+}
+
+/*
+ */
+void ExecutionServer::run(size_t workers_count)
+{
+	input_finished = false;
+	for (size_t i = 0; i < std::max<size_t>(workers_count, 1); i++)
+		workers.emplace_back(&ExecutionServer::workerLoop, this);
+
+	for (std::string request; std::getline(input, request);)
+	{
+		if (!request.empty() && request.back() == '\r')
+			request.pop_back();
+
+		if (request.empty())
+			continue;
+
+		Job job;
+		std::string error_description;
+		if (!parseJob(request, job, error_description))
+		{
+			writeResponse(job.id, false, error_description);
+			continue;
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(jobs_queue_mutex);
+			jobs_queue_space_condition.wait(lock, [this]() { return jobs_queue.size() < max_queued_jobs; });
+			jobs_queue.push_back(std::move(job));
+		}
+		jobs_queue_condition.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(jobs_queue_mutex);
+		input_finished = true;
+	}
+	jobs_queue_condition.notify_all();
+
+	for (std::thread &worker : workers)
+		worker.join();
+
+	workers.clear();
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef TM_EXECUTION_SERVER_INCLUDED
+#define TM_EXECUTION_SERVER_INCLUDED
+
+#include <Program.hpp>
+#include <TuringMachine.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Long-lived execution server. Reads jobs from input stream (one per line), runs them
+ * on a pool of worker threads and streams results back as soon as each job is finished.
+ * Compiled programs are cached by hash of source code and initial state name, so each
+ * program is compiled only once per server lifetime. Cached source is compared on each hit,
+ * so hash collision could cost only extra compilation. Input is read only while jobs queue
+ * has free space, so fast client couldn't make server buffer all of its requests.
+ *
+ * Request:  <job_id>\t<path_to_program>\t<begin_state_name>\t<default_tape_symbol>\t<iterations_limit>\t<tape_initial_data>
+ * Response: <job_id>\tok\t<result_tape>
+ *           <job_id>\terror\t<error_description>
+ */
+class ExecutionServer
+{
+	public:
+		constexpr static size_t max_queued_jobs = 1024;
+
+	private:
+		struct Job
+		{
+			std::string id;
+			std::string program_path;
+			std::string begin_state_name;
+			char default_tape_symbol;
+			size_t iterations_limit;
+			std::string tape_initial_data;
+		};
+
+		using ProgramPtr = std::shared_ptr<const TM::TuringProgram>;
+		struct CachedProgram
+		{
+			std::string source_code;
+			std::string begin_state_name;
+			ProgramPtr program;
+		};
+
+		std::istream &input;
+		std::ostream &output;
+
+		TM::ExecutionLimits limits;
+		size_t max_tape_bytes;
+		std::chrono::milliseconds job_timeout;
+
+		std::unordered_multimap<uint64_t, CachedProgram> programs_cache;
+		std::mutex programs_cache_mutex;
+
+		std::deque<Job> jobs_queue;
+		std::mutex jobs_queue_mutex;
+		std::condition_variable jobs_queue_condition;
+		std::condition_variable jobs_queue_space_condition;
+		bool input_finished;
+
+		std::mutex output_mutex;
+		std::vector<std::thread> workers;
+
+		static bool parseJob(const std::string &request, Job &job, std::string &error_description);
+
+		ProgramPtr findCachedProgram(uint64_t program_hash, const std::string &source_code, const std::string &begin_state_name) const;
+		ProgramPtr getProgram(const Job &job, std::string &error_description);
+		void processJob(const Job &job);
+		void workerLoop();
+		void writeResponse(const std::string &job_id, bool success, const std::string &message);
+
+	public:
+		// Limits are applied to each job, deadline is set to the job start plus job timeout (if it's not zero)
+		ExecutionServer(std::istream &input, std::ostream &output, const TM::ExecutionLimits &limits = {}, size_t max_tape_bytes = static_cast<size_t>(-1), std::chrono::milliseconds job_timeout = {}) :
+			input(input),
+			output(output),
+			limits(limits),
+			max_tape_bytes(max_tape_bytes),
+			job_timeout(job_timeout),
+			input_finished(false)
+		{}
+		ExecutionServer(const ExecutionServer &) = delete;
+		ExecutionServer & operator=(const ExecutionServer &) = delete;
+
+		void run(size_t workers_count = std::thread::hardware_concurrency());
+};
+
+#endif // TM_EXECUTION_SERVER_INCLUDED
\ No newline at end of file
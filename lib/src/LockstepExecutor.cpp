@@ -0,0 +1,313 @@
+#include "LockstepExecutor.hpp"
+
+#include <Tape.hpp>
+#include <TuringMachine.hpp>
+
+#include <algorithm>
+
+namespace TM
+{
+	LockstepExecutor::LockstepExecutor(const TuringProgram &program, char default_symbol, size_t lanes_count) :
+		program(program),
+		halted_state(0),
+		out_of_window_state(0),
+		default_symbol(default_symbol),
+		lanes_count(std::max<size_t>(lanes_count, 1)),
+		max_tape_bytes(static_cast<size_t>(-1)),
+		input_timeout(0),
+		is_cancelled(false),
+		tape_width(0),
+		tape_origin(0)
+	{
+		buildTransitions();
+	}
+
+	/*
+	 * Missing actions are stored as not defined transitions to the same state without any changes, so lane just
+	 * spins on them. Two sink states are added after program states: halted and out of window, they consist only
+	 * of such transitions. Symbol is always written, transitions that keep symbol unchanged just write the same one.
+	 */
+	void LockstepExecutor::buildTransitions()
+	{
+		transitions.clear();
+		if (!program.isValid())
+			return;
+
+		size_t states_count = program.getStatesCount();
+		halted_state = static_cast<uint32_t>(states_count);
+		out_of_window_state = static_cast<uint32_t>(states_count + 1);
+
+		transitions.resize((states_count + 2)*symbols_count);
+		for (size_t state_index = 0; state_index < states_count + 2; state_index++)
+		{
+			StateHandle state = program.getStateByIndex(state_index);
+			for (size_t symbol_index = 0; symbol_index < symbols_count; symbol_index++)
+			{
+				char symbol = static_cast<char>(symbol_index);
+				Transition &transition = transitions[state_index*symbols_count + symbol_index];
+
+				TuringProgram::Action action;
+				if (state.isNull() || !program.findStateAction(state, symbol, action))
+				{
+					transition = { static_cast<uint32_t>(state_index), symbol, 0, 0 };
+					continue;
+				}
+
+				transition.next_state = action.is_final_state ? halted_state : static_cast<uint32_t>(program.getStateIndex(action.new_state));
+				transition.new_symbol = action.replace_symbol ? action.new_symbol : symbol;
+				transition.offset = action.offset;
+				transition.flags = Defined;
+			}
+		}
+	}
+
+	ExecutionLimits::Clock::time_point LockstepExecutor::getInputDeadline() const
+	{
+		return input_timeout.count() != 0 ? ExecutionLimits::Clock::now() + input_timeout : limits.deadline;
+	}
+
+	void LockstepExecutor::loadLane(size_t lane, size_t input_index, const std::string &input, size_t iterations_limit)
+	{
+		for (size_t position = 0; position < tape_width; position++)
+			tapes[position*lanes_count + lane] = default_symbol;
+
+		for (size_t position = 0; position < input.size(); position++)
+			tapes[(tape_origin + position)*lanes_count + lane] = input[position];
+
+		lanes_state[lane] = 0;
+		lanes_head[lane] = tape_origin;
+		lanes_remaining_steps[lane] = iterations_limit;
+		lanes_input_index[lane] = input_index;
+		lanes_deadline[lane] = getInputDeadline();
+		lanes_status[lane] = LaneStatus::Running;
+	}
+
+	/*
+	 * Lanes statuses are updated from the results of this check, so clock is read only once for all lanes
+	 */
+	void LockstepExecutor::checkLimits()
+	{
+		is_cancelled = (limits.cancellation_token != nullptr && limits.cancellation_token->load(std::memory_order_relaxed));
+		if (limits.deadline != ExecutionLimits::Clock::time_point::max() || input_timeout.count() != 0)
+			check_time = ExecutionLimits::Clock::now();
+	}
+
+	LockstepExecutor::LaneStatus LockstepExecutor::getLaneStatus(size_t lane) const
+	{
+		uint32_t state = lanes_state[lane];
+		if (state == halted_state)
+			return LaneStatus::Halted;
+
+		if (state == out_of_window_state)
+			return LaneStatus::OutOfWindow;
+
+		// Scalar execution stops on limit before action lookup, so limit is checked first
+		if (lanes_remaining_steps[lane] == 0)
+			return LaneStatus::LimitReached;
+
+		if (is_cancelled)
+			return LaneStatus::Cancelled;
+
+		if (check_time >= lanes_deadline[lane])
+			return LaneStatus::DeadlineExceeded;
+
+		char current_symbol = tapes[lanes_head[lane]*lanes_count + lane];
+		if (!(transitions[state*symbols_count + static_cast<unsigned char>(current_symbol)].flags & Defined))
+			return LaneStatus::MissingAction;
+
+		return LaneStatus::Running;
+	}
+
+	/*
+	 * Result tape is trimmed the same way as Tape::trimRedundantSpaces() does it
+	 */
+	void LockstepExecutor::retireLane(size_t lane, const std::vector<std::string> &inputs, size_t iterations_limit, std::vector<Result> &results)
+	{
+		Result &result = results[lanes_input_index[lane]];
+		if (lanes_status[lane] == LaneStatus::OutOfWindow)
+		{
+			executeScalar(inputs[lanes_input_index[lane]], iterations_limit, lanes_deadline[lane], result);
+			return;
+		}
+
+		auto cell = [this, lane](size_t position) { return tapes[position*lanes_count + lane]; };
+
+		size_t head = lanes_head[lane];
+		size_t string_begin = 0;
+		while (string_begin < head && cell(string_begin) == default_symbol)
+			string_begin++;
+
+		size_t string_end = tape_width;
+		while (string_end > string_begin && cell(string_end - 1) == default_symbol)
+			string_end--;
+
+		result.tape.clear();
+		for (size_t position = string_begin; position < string_end; position++)
+			result.tape += cell(position);
+
+		result.steps_count = iterations_limit - lanes_remaining_steps[lane];
+		result.success = (lanes_status[lane] == LaneStatus::Halted);
+		result.error_description.clear();
+
+		if (lanes_status[lane] == LaneStatus::MissingAction)
+		{
+			std::string state_name = program.getStateName(program.getStateByIndex(lanes_state[lane]));
+			result.error_description = "Runtime error: state named \"" + state_name + "\" doesn't have entry for symbol \'" + cell(head) + "\'";
+		}
+		else if (lanes_status[lane] == LaneStatus::LimitReached)
+			result.error_description = "Runtime error: exceed maximum iterations limit (set to " + std::to_string(iterations_limit) + ")";
+		else if (lanes_status[lane] == LaneStatus::DeadlineExceeded)
+			result.error_description = "Runtime error: execution deadline exceeded";
+		else if (lanes_status[lane] == LaneStatus::Cancelled)
+			result.error_description = "Runtime error: execution is cancelled";
+	}
+
+	/*
+	 * Steps count must not exceed remaining steps of any running lane, so limit is never overrun
+	 */
+	void LockstepExecutor::stepLanes(size_t steps_count)
+	{
+		// Everything is copied to locals, because writes to tape cells (char) could alias any member otherwise
+		const Transition *transitions_table = transitions.data();
+		char *cells = tapes.data();
+		uint32_t *states = lanes_state.data();
+		size_t *heads = lanes_head.data();
+		size_t *remaining_steps = lanes_remaining_steps.data();
+		const uint32_t out_of_window = out_of_window_state;
+		const size_t lanes = lanes_count;
+		const size_t width = tape_width;
+
+		for (size_t step = 0; step < steps_count; step++)
+		{
+			for (size_t lane = 0; lane < lanes; lane++)
+			{
+				size_t head = heads[lane];
+				char &current_symbol = cells[head*lanes + lane];
+				const Transition transition = transitions_table[states[lane]*symbols_count + static_cast<unsigned char>(current_symbol)];
+
+				current_symbol = transition.new_symbol;
+				remaining_steps[lane] -= (transition.flags & Defined);
+
+				// Moving before the first cell overflows the index, so one check covers both directions
+				size_t new_head = head + transition.offset;
+				bool is_inside_window = new_head < width;
+				heads[lane] = is_inside_window ? new_head : head;
+				states[lane] = is_inside_window ? transition.next_state : out_of_window;
+			}
+		}
+	}
+
+	void LockstepExecutor::executeScalar(const std::string &input, size_t iterations_limit, ExecutionLimits::Clock::time_point deadline, Result &result) const
+	{
+		Tape tape(default_symbol, input, 0, max_tape_bytes);
+		TuringMachine turing_machine(program, tape);
+
+		ExecutionLimits input_limits = limits;
+		input_limits.deadline = deadline;
+		turing_machine.setLimits(input_limits);
+
+		result.error_description.clear();
+		result.success = turing_machine.execute(result.error_description, iterations_limit);
+		result.steps_count = turing_machine.getStepsCount();
+
+		tape.trimRedundantSpaces();
+		result.tape.assign(tape.getString(), tape.size());
+	}
+
+	/*
+	 * Each lane takes next input as soon as previous one is finished, so all lanes are busy until inputs are over
+	 */
+	void LockstepExecutor::execute(const std::vector<std::string> &inputs, size_t iterations_limit, std::vector<Result> &results)
+	{
+		results.assign(inputs.size(), Result());
+		if (transitions.empty())
+		{
+			for (size_t i = 0; i < inputs.size(); i++)
+				executeScalar(inputs[i], iterations_limit, getInputDeadline(), results[i]);
+
+			return;
+		}
+
+		size_t max_input_size = 0;
+		for (const std::string &input : inputs)
+			max_input_size = std::max(max_input_size, input.size());
+
+		tape_origin = std::max(minimal_tape_margin, max_input_size);
+		tape_width = tape_origin*2 + max_input_size;
+
+		// Lane can't visit more cells than window has, so narrowed window makes tape cells limit exact
+		// (usual TuringMachine counts cell after initial string too, so inputs must fit with it, see isFittingWindow())
+		if (tape_width > limits.max_tape_cells)
+		{
+			tape_width = limits.max_tape_cells;
+			tape_origin = (tape_width > max_input_size + 1) ? (tape_width - max_input_size - 1)/2 : 0;
+		}
+
+		tapes.assign(tape_width*lanes_count, default_symbol);
+
+		lanes_state.assign(lanes_count, halted_state);
+		lanes_head.assign(lanes_count, 0);
+		lanes_remaining_steps.assign(lanes_count, 0);
+		lanes_input_index.assign(lanes_count, 0);
+		lanes_deadline.assign(lanes_count, ExecutionLimits::Clock::time_point::max());
+		lanes_status.assign(lanes_count, LaneStatus::Empty);
+
+		check_time = ExecutionLimits::Clock::time_point::min();
+		checkLimits();
+
+		size_t next_input_index = 0;
+		auto loadNextInput = [&](size_t lane)
+		{
+			for (; next_input_index < inputs.size(); next_input_index++)
+			{
+				const std::string &input = inputs[next_input_index];
+				if (isFittingWindow(input))
+				{
+					loadLane(lane, next_input_index++, input, iterations_limit);
+					return;
+				}
+
+				executeScalar(input, iterations_limit, getInputDeadline(), results[next_input_index]);
+			}
+		};
+
+		for (size_t lane = 0; lane < lanes_count; lane++)
+			loadNextInput(lane);
+
+		const size_t limits_check_interval = std::max<size_t>(limits.check_interval, 1);
+		size_t steps_before_check = limits_check_interval;
+		for (;;)
+		{
+			size_t steps_count = check_interval;
+			bool have_running_lanes = false;
+			for (size_t lane = 0; lane < lanes_count; lane++)
+			{
+				while (lanes_status[lane] != LaneStatus::Empty && (lanes_status[lane] = getLaneStatus(lane)) != LaneStatus::Running)
+				{
+					retireLane(lane, inputs, iterations_limit, results);
+					lanes_status[lane] = LaneStatus::Empty;
+					loadNextInput(lane);
+				}
+
+				if (lanes_status[lane] == LaneStatus::Running)
+				{
+					steps_count = std::min(steps_count, lanes_remaining_steps[lane]);
+					have_running_lanes = true;
+				}
+			}
+
+			if (!have_running_lanes)
+				break;
+
+			stepLanes(steps_count);
+
+			if (steps_count >= steps_before_check)
+			{
+				checkLimits();
+				steps_before_check = limits_check_interval;
+			}
+			else
+				steps_before_check -= steps_count;
+		}
+	}
+}
\ No newline at end of file
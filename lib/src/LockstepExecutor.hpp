@@ -0,0 +1,127 @@
+#ifndef TM_LOCKSTEP_EXECUTOR_INCLUDED
+#define TM_LOCKSTEP_EXECUTOR_INCLUDED
+
+#include <Program.hpp>
+#include <TuringMachine.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace TM
+{
+	/*
+	 * Executes the same program on many inputs, advancing several machines (lanes) in lockstep.
+	 * Lanes data is stored as structure of arrays, all lookups go to dense transition table (state x symbol)
+	 * and tapes are interleaved (cell i of lane j has index i*lanes_count + j), so each step of all lanes
+	 * is a tight branchless loop without hash lookups, function calls or tape reallocations.
+	 * Loop is scalar, speedup comes from interleaving: lanes are independent, so their dependent loads overlap.
+	 * Compilers don't vectorize it (byte gathers and scatter to tapes), and vectorized variant with 32-bit cells
+	 * and split table wasn't faster, because gathers issue the same number of loads.
+	 * Stopped lanes just spin in place (on missing action or in one of the sink states), their status is
+	 * determined only once per check interval, and they are refilled with the next inputs.
+	 * Tape of each lane is fixed-size window, if machine leaves it, input is executed again on the usual TuringMachine.
+	 * Window is never wider than tape cells limit, so the limit could be exceeded only by leaving the window, and inputs
+	 * that don't fit into it are executed on the usual TuringMachine right away. Tape memory limit is applied only to
+	 * such executions, windows are allocated once for all lanes. Deadlines and cancellation token are checked once per
+	 * ExecutionLimits::check_interval steps.
+	 */
+	class LockstepExecutor
+	{
+		public:
+			struct Result
+			{
+				bool success;
+				size_t steps_count;
+				std::string tape;
+				std::string error_description;
+			};
+
+			constexpr static size_t default_lanes_count = 16;
+
+		private:
+			struct Transition
+			{
+				uint32_t next_state;
+				char new_symbol;
+				int8_t offset;
+				uint8_t flags;
+			};
+
+			enum TransitionFlags : uint8_t
+			{
+				Defined = 1 << 0,
+			};
+
+			enum class LaneStatus : uint8_t
+			{
+				Running,
+				Halted,
+				MissingAction,
+				OutOfWindow,
+				LimitReached,
+				DeadlineExceeded,
+				Cancelled,
+				Empty,
+			};
+
+			constexpr static size_t symbols_count = 256;
+			constexpr static size_t check_interval = 16;
+			constexpr static size_t minimal_tape_margin = 16;
+
+			const TuringProgram &program;
+			std::vector<Transition> transitions;
+			uint32_t halted_state;
+			uint32_t out_of_window_state;
+			char default_symbol;
+			size_t lanes_count;
+
+			ExecutionLimits limits;
+			size_t max_tape_bytes;
+			std::chrono::milliseconds input_timeout;
+			bool is_cancelled;
+			ExecutionLimits::Clock::time_point check_time;
+
+			std::vector<uint32_t> lanes_state;
+			std::vector<size_t> lanes_head;
+			std::vector<size_t> lanes_remaining_steps;
+			std::vector<size_t> lanes_input_index;
+			std::vector<ExecutionLimits::Clock::time_point> lanes_deadline;
+			std::vector<LaneStatus> lanes_status;
+			std::vector<char> tapes;
+			size_t tape_width;
+			size_t tape_origin;
+
+			void buildTransitions();
+			ExecutionLimits::Clock::time_point getInputDeadline() const;
+			bool isFittingWindow(const std::string &input) const { return input.size() < tape_width - tape_origin; }
+			void loadLane(size_t lane, size_t input_index, const std::string &input, size_t iterations_limit);
+			void checkLimits();
+			LaneStatus getLaneStatus(size_t lane) const;
+			void retireLane(size_t lane, const std::vector<std::string> &inputs, size_t iterations_limit, std::vector<Result> &results);
+			void stepLanes(size_t steps_count);
+
+			void executeScalar(const std::string &input, size_t iterations_limit, ExecutionLimits::Clock::time_point deadline, Result &result) const;
+
+		public:
+			LockstepExecutor(const LockstepExecutor &) = delete;
+			LockstepExecutor & operator=(const LockstepExecutor &) = delete;
+
+			LockstepExecutor(const TuringProgram &program, char default_symbol = '_', size_t lanes_count = default_lanes_count);
+
+			// Limits are applied to each input, deadline is set to the input start plus input timeout (if it's not zero)
+			void setLimits(const ExecutionLimits &new_limits, size_t new_max_tape_bytes = static_cast<size_t>(-1), std::chrono::milliseconds new_input_timeout = {})
+			{
+				limits = new_limits;
+				max_tape_bytes = new_max_tape_bytes;
+				input_timeout = new_input_timeout;
+			}
+
+			// Results are stored in the same order as inputs
+			void execute(const std::vector<std::string> &inputs, size_t iterations_limit, std::vector<Result> &results);
+	};
+}
+
+#endif // TM_LOCKSTEP_EXECUTOR_INCLUDED
\ No newline at end of file
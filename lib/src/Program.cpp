@@ -1,5 +1,6 @@
 #include "Program.hpp"
 
+#include <algorithm>
 #include <cctype>
 #include <set>
 
@@ -7,6 +8,10 @@ static constexpr char EndOfLine = '\n';
 static constexpr char Comment = ';';
 static constexpr char AnySymbol = '*';
 
+static constexpr size_t SymbolsCount = 256;
+static constexpr uint64_t FnvOffsetBasis = 14695981039346656037ull;
+static constexpr uint64_t FnvPrime = 1099511628211ull;
+
 static bool isSpace(char symbol) { return symbol == EndOfLine || std::isblank(static_cast<unsigned char>(symbol)); }
 
 static bool isAllowedStateNameSymbol(char symbol) { return symbol == '_' || symbol == '-' || std::isalnum(static_cast<unsigned char>(symbol)); }
@@ -299,6 +304,22 @@ namespace TM
 
 	/*
 	 */
+	uint64_t TuringProgram::hashSource(const std::string &source_code, const std::string &initial_state_name)
+	{
+		// FNV-1a, initial state name is the part of the hash because it changes compilation result
+		uint64_t hash = FnvOffsetBasis;
+		auto hashString = [&hash](const std::string &string)
+		{
+			for (char symbol : string)
+				hash = (hash ^ static_cast<unsigned char>(symbol))*FnvPrime;
+			hash = hash*FnvPrime;
+		};
+
+		hashString(source_code);
+		hashString(initial_state_name);
+		return hash;
+	}
+
 	bool TuringProgram::compile(const std::string &source_code, ErrorInfo &error_info, const std::string &initial_state_name)
 	{
 		error_info.description = "";
@@ -313,6 +334,7 @@ namespace TM
 
 		clear();
 		program_id = generateProgramID();
+		fingerprint = hashSource(source_code, initial_state_name);
 
 		CompilationContext context;
 		context.nextTokenParser = &TuringProgram::parseStateName;
@@ -392,4 +414,135 @@ namespace TM
 
 		return true;
 	}
+
+	/*
+	 * Greedy chaining: each next placed state is the hottest not placed successor of the last placed one,
+	 * or the hottest not placed state if there are no such successors. Never executed states keep their order.
+	 */
+	std::vector<size_t> TuringProgram::computeStatesOrder(const std::vector<uint64_t> &transitions_counts) const
+	{
+		std::vector<size_t> order;
+		if (!isValid())
+			return order;
+
+		size_t states_count = states.size();
+		std::vector<uint64_t> states_weights(states_count, 0);
+		std::vector<std::vector<std::pair<uint64_t, size_t>>> successors(states_count);
+		for (size_t state_index = 0; state_index < states_count; state_index++)
+		{
+			std::unordered_map<size_t, uint64_t> successors_weights;
+			for (size_t symbol = 0; symbol < SymbolsCount && state_index*SymbolsCount + symbol < transitions_counts.size(); symbol++)
+			{
+				uint64_t count = transitions_counts[state_index*SymbolsCount + symbol];
+				Action action;
+				if (count == 0 || !findStateAction(StateHandle(state_index, program_id), static_cast<char>(symbol), action))
+					continue;
+
+				states_weights[state_index] += count;
+				if (!action.is_final_state)
+					successors_weights[action.new_state] += count;
+			}
+
+			for (const auto & [successor_index, weight] : successors_weights)
+				successors[state_index].push_back({ weight, successor_index });
+
+			std::sort(successors[state_index].begin(), successors[state_index].end(), [](const auto &left, const auto &right)
+			{
+				return left.first != right.first ? left.first > right.first : left.second < right.second;
+			});
+		}
+
+		std::vector<size_t> hot_states;
+		for (size_t state_index = 1; state_index < states_count; state_index++)
+			hot_states.push_back(state_index);
+
+		std::stable_sort(hot_states.begin(), hot_states.end(), [&states_weights](size_t left, size_t right)
+		{
+			return states_weights[left] > states_weights[right];
+		});
+
+		std::vector<bool> is_placed(states_count, false);
+		size_t next_hot_state = 0;
+
+		order.reserve(states_count);
+		order.push_back(0);
+		is_placed[0] = true;
+		while (order.size() < states_count)
+		{
+			size_t next_state = states_count;
+			for (const auto & [weight, successor_index] : successors[order.back()])
+			{
+				if (!is_placed[successor_index])
+				{
+					next_state = successor_index;
+					break;
+				}
+			}
+
+			if (next_state == states_count)
+			{
+				while (is_placed[hot_states[next_hot_state]])
+					next_hot_state++;
+
+				next_state = hot_states[next_hot_state];
+			}
+
+			order.push_back(next_state);
+			is_placed[next_state] = true;
+		}
+
+		return order;
+	}
+
+	bool TuringProgram::reorderStates(const std::vector<size_t> &order)
+	{
+		if (!isValid() || order.size() != states.size() || order.empty() || order[0] != 0)
+			return false;
+
+		std::vector<size_t> new_indices(states.size(), states.size());
+		for (size_t new_index = 0; new_index < order.size(); new_index++)
+		{
+			if (order[new_index] >= states.size() || new_indices[order[new_index]] != states.size())
+				return false;
+
+			new_indices[order[new_index]] = new_index;
+		}
+
+		// Handles from previous layout become invalid, because program gets new id
+		size_t new_program_id = generateProgramID();
+		auto updateAction = [&new_indices, new_program_id](Action &action)
+		{
+			if (!action.is_final_state)
+				action.new_state = StateHandle(new_indices[action.new_state], new_program_id);
+		};
+
+		// Actions are inserted into new maps while old ones are still alive, so nodes of adjacent states are allocated
+		// next to each other instead of reusing memory freed in original order
+		std::vector<State> new_states(states.size());
+		for (size_t new_index = 0; new_index < order.size(); new_index++)
+		{
+			State &old_state = states[order[new_index]];
+			State &state = new_states[new_index];
+
+			state.name = std::move(old_state.name);
+			state.have_default_action = old_state.have_default_action;
+			state.default_action = old_state.default_action;
+			if (state.have_default_action)
+				updateAction(state.default_action);
+
+			state.actions.reserve(old_state.actions.size());
+			for (auto [symbol, action] : old_state.actions)
+			{
+				updateAction(action);
+				state.actions.emplace(symbol, action);
+			}
+
+			fingerprint = (fingerprint ^ order[new_index])*FnvPrime;
+		}
+
+		states = std::move(new_states);
+		program_id = new_program_id;
+
+		return true;
+	}
 }
\ No newline at end of file
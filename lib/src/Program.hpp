@@ -1,6 +1,7 @@
 #ifndef TM_TURING_PROGRAM_INCLUDED
 #define TM_TURING_PROGRAM_INCLUDED
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <string>
@@ -61,10 +62,11 @@ namespace TM
 
 			std::vector<State> states;
 			size_t program_id;
+			uint64_t fingerprint;
 
 			static size_t generateProgramID()
 			{
-				static size_t free_id = 1;
+				static std::atomic<size_t> free_id = 1;
 				return free_id++;
 			}
 
@@ -86,13 +88,28 @@ namespace TM
 			static std::string formatErrorMessage(CompilationError error, char current_symbol, const CompilationContext &context);
 
 		public:
-			TuringProgram() : program_id(0) {}
+			TuringProgram() : program_id(0), fingerprint(0) {}
 			~TuringProgram() = default;
 
+			static uint64_t hashSource(const std::string &source_code, const std::string &initial_state_name);
 			bool compile(const std::string &source_code, ErrorInfo &error_info, const std::string &initial_state_name);
 
 			bool isValid() const { return program_id != 0; }
-			void clear() { states.clear(), program_id = 0; }
+			void clear() { states.clear(), program_id = 0, fingerprint = 0; }
+
+			// Identifies program between launches, equal for programs compiled from the same sources with the same states order
+			uint64_t getFingerprint() const { return fingerprint; }
+			size_t getStatesCount() const { return states.size(); }
+			size_t getStateIndex(StateHandle state_handle) const { return state_handle.program_id == program_id ? state_handle.index : static_cast<size_t>(-1); }
+			StateHandle getStateByIndex(size_t index) const { return isValid() && index < states.size() ? StateHandle(index, program_id) : StateHandle(); }
+
+			/*
+			 * Profile-guided states reordering. Counts of executed transitions are indexed by state_index*256 + symbol.
+			 * Order maps new state index to old one, hot states are followed by their hottest successors, so they
+			 * are adjacent in memory. Initial state always stays first. Reordering invalidates all state handles.
+			 */
+			std::vector<size_t> computeStatesOrder(const std::vector<uint64_t> &transitions_counts) const;
+			bool reorderStates(const std::vector<size_t> &order);
 
 			StateHandle getInitialState() const { return isValid() ? StateHandle(0, program_id) : StateHandle(); }
 			std::string getStateName(StateHandle state_handle) const { return isValid() ? states[state_handle].name : ""; }
@@ -0,0 +1,29 @@
+#ifndef TM_SERIALIZATION_INCLUDED
+#define TM_SERIALIZATION_INCLUDED
+
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+namespace TM
+{
+	/*
+	 * Raw binary values I/O, used by checkpoints. Values are stored in host byte order,
+	 * so checkpoints are portable only between machines with the same architecture.
+	 */
+	template<typename T>
+	void writeBinary(std::ostream &output, const T &value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values could be written");
+		output.write(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	bool readBinary(std::istream &input, T &value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values could be read");
+		return static_cast<bool>(input.read(reinterpret_cast<char *>(&value), sizeof(T)));
+	}
+}
+
+#endif // TM_SERIALIZATION_INCLUDED
\ No newline at end of file
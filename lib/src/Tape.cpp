@@ -1,56 +1,79 @@
 #include "Tape.hpp"
+#include "Serialization.hpp"
 
 #include <algorithm>
 #include <cstring>
+#include <sstream>
 
 namespace TM
 {
-	void Tape::resize()
+	bool Tape::resize(bool backward)
 	{
-		size_t storage_size = storage.size() - 1;
-		size_t new_size = storage_size*resize_policy;
-		std::vector<char> new_storage(new_size + 1, empty_symbol);
+		size_t shift;
+		if (!storage.grow(resize_policy, backward, empty_symbol, storage_limit, shift))
+		{
+			// Heap storage fails to grow only because of limit, mapped one also when mapping is exhausted
+			storage_limit_reached = !storage.isFileMapped() || storage.size() >= storage_limit;
+			return false;
+		}
 
-		std::memcpy(new_storage.data() + storage_size, storage.data(), storage_size);
-		storage = std::move(new_storage);
+		string_begin += shift;
+		string_end += shift;
+		current_symbol += shift;
+		origin += shift;
+		touched_begin += shift;
+		touched_end += shift;
 
-		string_begin += storage_size;
-		string_end += storage_size;
-		storage[string_end] = '\0';
-		current_symbol += storage_size - 1;
+		return true;
 	}
 
 	/*
 	 */
 	void Tape::reset(char default_symbol, const std::string &initial_string, size_t initial_position)
 	{
+		// Storage is limited, but it always has place for initial string, head after its end and terminating zero
 		size_t block_size = std::max(initial_size, initial_string.size());
-		size_t storage_required_size = block_size*resize_policy;
-		if (storage.size() <= storage_required_size || empty_symbol != default_symbol)
+		size_t storage_required_size = std::max(std::min(block_size*resize_policy + 1, storage_limit), initial_string.size() + 2);
+		if (storage.size() < storage_required_size || storage.size() > storage_limit || empty_symbol != default_symbol || storage.isFileMapped())
 		{
-			std::vector<char> new_storage(storage_required_size + 1, default_symbol);
-			storage = std::move(new_storage);
+			storage.allocate(storage_required_size, default_symbol);
 			empty_symbol = default_symbol;
 		}
+		else // Storage is reused, so only visited cells (and terminating zero) should be cleared
+			std::fill(storage.data() + string_begin, storage.data() + string_end + 1, empty_symbol);
 
-		std::memcpy(storage.data() + block_size, initial_string.c_str(), initial_string.size());
+		// String is placed in the middle, so reused storage have the same space for growth in both directions
+		string_begin = (storage.size() - 1 - initial_string.size())/2;
+		std::memcpy(storage.data() + string_begin, initial_string.c_str(), initial_string.size());
 
-		string_begin = block_size;
 		string_end = string_begin + initial_string.size() + 1;
 		storage[string_end] = '\0';
 
 		current_symbol = string_begin + std::min(initial_position, initial_string.size());
+		origin = string_begin;
+		touched_begin = current_symbol;
+		touched_end = current_symbol + 1;
 
 		last_move_offset = 0;
 		current_symbol_initial_value = storage[current_symbol];
+		storage_limit_reached = false;
 	}
 
-	void Tape::moveHead(int8_t offset)
+	/*
+	 * Returns false if tape couldn't grow anymore (only possible for file-mapped tape), head is not moved in that case
+	 */
+	bool Tape::moveHead(int8_t offset)
 	{
+		// Moving before the first cell overflows the index, so one check covers both directions
 		while (storage.size() - 1 <= current_symbol + offset)
-			resize();
+		{
+			if (!resize(offset < 0))
+				return false;
+		}
 
 		current_symbol += offset;
+		touched_begin = std::min(touched_begin, current_symbol);
+		touched_end = std::max(touched_end, current_symbol + 1);
 		string_begin = std::min(string_begin, current_symbol);
 		if (current_symbol >= string_end)
 		{
@@ -61,6 +84,8 @@ namespace TM
 
 		last_move_offset = offset;
 		current_symbol_initial_value = storage[current_symbol];
+
+		return true;
 	}
 
 	void Tape::trimRedundantSpaces()
@@ -74,4 +99,199 @@ namespace TM
 
 		storage[string_end] = '\0';
 	}
+
+	/*
+	 * Only visited cells are saved, all other cells are equal to empty symbol anyway
+	 */
+	void Tape::save(std::ostream &output) const
+	{
+		writeBinary(output, empty_symbol);
+		writeBinary(output, static_cast<uint64_t>(string_end - string_begin));
+		writeBinary(output, static_cast<uint64_t>(current_symbol - string_begin));
+		writeBinary(output, last_move_offset);
+		writeBinary(output, current_symbol_initial_value);
+		output.write(storage.data() + string_begin, string_end - string_begin);
+	}
+
+	bool Tape::load(std::istream &input)
+	{
+		char default_symbol;
+		uint64_t string_size;
+		uint64_t head_position;
+		int8_t saved_last_move_offset;
+		char saved_current_symbol_initial_value;
+
+		bool success =
+			readBinary(input, default_symbol) &&
+			readBinary(input, string_size) &&
+			readBinary(input, head_position) &&
+			readBinary(input, saved_last_move_offset) &&
+			readBinary(input, saved_current_symbol_initial_value);
+
+		// Head is always on visited cell, so it's strictly inside the string
+		if (!success || head_position >= string_size)
+			return false;
+
+		// Size is read from file, so string grows by chunks, and corrupted size fails on end of data instead of allocation
+		std::string string;
+		while (string.size() < string_size)
+		{
+			size_t read_size = static_cast<size_t>(std::min<uint64_t>(load_chunk_size, string_size - string.size()));
+			size_t read_position = string.size();
+
+			string.resize(read_position + read_size);
+			if (!input.read(string.data() + read_position, read_size))
+				return false;
+		}
+
+		// Reset appends one extra visited cell after the string, so it should be removed to restore exact state
+		reset(default_symbol, string, head_position);
+		storage[string_end] = empty_symbol;
+		string_end = string_begin + string_size;
+		storage[string_end] = '\0';
+
+		last_move_offset = saved_last_move_offset;
+		current_symbol_initial_value = saved_current_symbol_initial_value;
+
+		return true;
+	}
+
+	size_t Tape::Changes::getCellsCount() const
+	{
+		size_t cells_count = 0;
+		for (const Segment &segment : segments)
+			cells_count += segment.cells.size();
+
+		return cells_count;
+	}
+
+	/*
+	 * Segments of both changes are disjoint sets, so their union is split into continuous ranges,
+	 * that are painted by own segments first and then by next ones (newer values win)
+	 */
+	void Tape::Changes::merge(const Changes &next_changes)
+	{
+		std::vector<const Segment *> all_segments;
+		for (const Segment &segment : segments)
+			all_segments.push_back(&segment);
+		for (const Segment &segment : next_changes.segments)
+			all_segments.push_back(&segment);
+
+		std::sort(all_segments.begin(), all_segments.end(), [](const Segment *a, const Segment *b) { return a->position < b->position; });
+
+		std::vector<Segment> merged_segments;
+		for (const Segment *segment : all_segments)
+		{
+			ptrdiff_t segment_end = segment->position + static_cast<ptrdiff_t>(segment->cells.size());
+			if (merged_segments.empty() || merged_segments.back().position + static_cast<ptrdiff_t>(merged_segments.back().cells.size()) < segment->position)
+				merged_segments.push_back({ segment->position, "" });
+
+			Segment &merged_segment = merged_segments.back();
+			merged_segment.cells.resize(std::max<size_t>(merged_segment.cells.size(), segment_end - merged_segment.position));
+		}
+
+		auto paint = [&merged_segments](const Segment &segment)
+		{
+			auto it = std::upper_bound(merged_segments.begin(), merged_segments.end(), segment.position,
+				[](ptrdiff_t position, const Segment &merged_segment) { return position < merged_segment.position; });
+
+			Segment &merged_segment = *std::prev(it);
+			merged_segment.cells.replace(segment.position - merged_segment.position, segment.cells.size(), segment.cells);
+		};
+
+		for (const Segment &segment : segments)
+			paint(segment);
+		for (const Segment &segment : next_changes.segments)
+			paint(segment);
+
+		segments = std::move(merged_segments);
+		visited_begin = next_changes.visited_begin;
+		visited_end = next_changes.visited_end;
+		head_position = next_changes.head_position;
+		last_move_offset = next_changes.last_move_offset;
+		current_symbol_initial_value = next_changes.current_symbol_initial_value;
+	}
+
+	/*
+	 * Machine writes only under head, so cells outside of touched range are the same as on previous call
+	 */
+	void Tape::takeChanges(Changes &changes, bool all_visited_cells)
+	{
+		size_t range_begin = all_visited_cells ? string_begin : touched_begin;
+		size_t range_end = all_visited_cells ? string_end : touched_end;
+
+		changes.visited_begin = static_cast<ptrdiff_t>(string_begin - origin);
+		changes.visited_end = static_cast<ptrdiff_t>(string_end - origin);
+		changes.head_position = static_cast<ptrdiff_t>(current_symbol - origin);
+		changes.last_move_offset = last_move_offset;
+		changes.current_symbol_initial_value = current_symbol_initial_value;
+		changes.segments.assign(1, { static_cast<ptrdiff_t>(range_begin - origin), std::string(storage.data() + range_begin, range_end - range_begin) });
+
+		touched_begin = current_symbol;
+		touched_end = current_symbol + 1;
+	}
+
+	/*
+	 * Visited range only grows while changes are applied in order, so newly visited cells that aren't covered
+	 * by segments just keep empty symbol. Returns false if storage couldn't grow to fit visited range.
+	 */
+	bool Tape::applyChanges(const Changes &changes)
+	{
+		while (static_cast<ptrdiff_t>(origin) + changes.visited_begin < 0)
+		{
+			if (!resize(true))
+				return false;
+		}
+
+		while (static_cast<ptrdiff_t>(origin) + changes.visited_end >= static_cast<ptrdiff_t>(storage.size()))
+		{
+			if (!resize(false))
+				return false;
+		}
+
+		storage[string_end] = empty_symbol;
+		for (const Changes::Segment &segment : changes.segments)
+			std::memcpy(storage.data() + origin + segment.position, segment.cells.data(), segment.cells.size());
+
+		string_begin = origin + changes.visited_begin;
+		string_end = origin + changes.visited_end;
+		storage[string_end] = '\0';
+
+		current_symbol = origin + changes.head_position;
+		last_move_offset = changes.last_move_offset;
+		current_symbol_initial_value = changes.current_symbol_initial_value;
+
+		touched_begin = current_symbol;
+		touched_end = current_symbol + 1;
+
+		return true;
+	}
+
+	bool Tape::mapFile(const std::string &path, size_t reserved_size)
+	{
+		std::stringstream tape_data;
+		save(tape_data);
+
+		// Mapping should fit at least current cells and initial storage size
+		if (reserved_size < TapeStorage::file_header_size + (size() + initial_size)*resize_policy + 1)
+			return false;
+
+		// Tape is restored even on failure, then it just stays in heap
+		bool is_mapped = storage.mapFile(path, reserved_size);
+		load(tape_data);
+
+		return is_mapped;
+	}
+
+	void Tape::unmapFile()
+	{
+		if (!storage.isFileMapped())
+			return;
+
+		std::stringstream tape_data;
+		save(tape_data);
+
+		storage.unmapFile(string_begin, string_end);
+		load(tape_data);
+	}
 }
\ No newline at end of file
@@ -2,8 +2,12 @@
 #ifndef TM_ENDLESS_TAPE_INCLUDED
 #define TM_ENDLESS_TAPE_INCLUDED
 
+#include <TapeStorage.hpp>
+
 #include <cstddef>
 #include <cstdint>
+#include <istream>
+#include <ostream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -15,26 +19,85 @@ namespace TM
 		public:
 			constexpr static size_t initial_size = 64;
 			constexpr static size_t resize_policy = 3;
+			constexpr static size_t load_chunk_size = 1 << 20;
+			constexpr static size_t default_file_reserved_size = sizeof(size_t) >= 8 ? static_cast<size_t>(1) << 36 : static_cast<size_t>(1) << 30;
+
+			/*
+			 * Changes of tape since previous Tape::takeChanges() call: cells in range touched by head and bounds
+			 * of visited cells. Positions are relative to the first cell of initial string, so they don't depend
+			 * on storage growth. Changes applied in the same order to tape reset with the same default symbol
+			 * restore exact tape.
+			 */
+			struct Changes
+			{
+				struct Segment
+				{
+					ptrdiff_t position;
+					std::string cells;
+				};
+
+				ptrdiff_t visited_begin = 0;
+				ptrdiff_t visited_end = 0;
+				ptrdiff_t head_position = 0;
+				int8_t last_move_offset = 0;
+				char current_symbol_initial_value = 0;
+				std::vector<Segment> segments;
+
+				size_t getCellsCount() const;
+
+				// Combines with the next changes, so result could be applied instead of both
+				void merge(const Changes &next_changes);
+			};
 
 		private:
-			std::vector<char> storage;
+			TapeStorage storage;
 
 			size_t string_begin;
 			size_t string_end;
 			size_t current_symbol;
 
+			// Index of the first cell of initial string and range touched by head since last reset or taken changes
+			size_t origin;
+			size_t touched_begin;
+			size_t touched_end;
+
 			int8_t last_move_offset;
 			char current_symbol_initial_value;
 			char empty_symbol;
 
-			void resize();
+			size_t storage_limit = static_cast<size_t>(-1);
+			bool storage_limit_reached = false;
+
+			bool resize(bool backward);
 
 		public:
-			Tape(char default_symbol = '_', const std::string &initial_string = "", size_t initial_position = 0) { reset(default_symbol, initial_string, initial_position); }
+			Tape(char default_symbol = '_', const std::string &initial_string = "", size_t initial_position = 0, size_t storage_limit = static_cast<size_t>(-1)) :
+				storage_limit(storage_limit)
+			{
+				reset(default_symbol, initial_string, initial_position);
+			}
+			Tape(const Tape &) = delete;
+			Tape & operator=(const Tape &) = delete;
+			~Tape() { storage.unmapFile(string_begin, string_end); }
 
 			void reset(char default_symbol = '_', const std::string &initial_string = "", size_t initial_position = 0);
 
-			void moveHead(int8_t offset);
+			// Moves tape cells into sparse memory-mapped file, file will contain visited cells after tape is destroyed
+			bool mapFile(const std::string &path, size_t reserved_size = default_file_reserved_size);
+			void unmapFile();
+			bool isFileMapped() const { return storage.isFileMapped(); }
+
+			/*
+			 * Limits memory (in bytes) that tape could take, moveHead() fails if tape should grow beyond it.
+			 * During heap growth both old and new cells are counted, so it limits peak memory. Initial storage
+			 * fits the limit too (it's applied on reset, so pass it to constructor), unless initial string doesn't fit.
+			 */
+			void setStorageLimit(size_t max_bytes) { storage_limit = max_bytes; }
+			size_t getStorageLimit() const { return storage_limit; }
+			bool isStorageLimitReached() const { return storage_limit_reached; }
+			size_t capacity() const { return storage.size(); }
+
+			bool moveHead(int8_t offset);
 			char & getCurrentSymbol() { return storage[current_symbol]; }
 			char getCurrentSymbol() const { return storage[current_symbol]; }
 			char & operator*() { return getCurrentSymbol(); }
@@ -45,7 +108,16 @@ namespace TM
 			char getDefaultSymbol() const { return empty_symbol; }
 			const char * getString() const { return storage.data() + string_begin; }
 			size_t size() const { return string_end - string_begin; }
+			size_t getHeadPosition() const { return current_symbol - string_begin; }
 			void trimRedundantSpaces();
+
+			void save(std::ostream &output) const;
+			size_t getSavedSize() const { return sizeof(empty_symbol) + sizeof(uint64_t)*2 + sizeof(last_move_offset) + sizeof(current_symbol_initial_value) + size(); }
+			bool load(std::istream &input);
+
+			// With all_visited_cells flag all visited cells are taken instead of touched ones (for the first changes)
+			void takeChanges(Changes &changes, bool all_visited_cells = false);
+			bool applyChanges(const Changes &changes);
 	};
 }
 
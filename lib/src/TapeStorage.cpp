@@ -0,0 +1,192 @@
+#include "TapeStorage.hpp"
+#include "Serialization.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define TM_TAPE_STORAGE_MAPPING_SUPPORTED
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+static constexpr char FileHeaderSignature[4] = { 'T', 'M', 'T', 'F' };
+static constexpr uint32_t FileHeaderVersion = 1;
+
+namespace TM
+{
+	/*
+	 * File is truncated to reserved size without writing, so it stays sparse and takes disk space only for visited cells.
+	 */
+	bool TapeStorage::mapFile(const std::string &path, size_t reserved_size)
+	{
+#ifdef TM_TAPE_STORAGE_MAPPING_SUPPORTED
+		unmapFile(0, 0, false);
+		if (reserved_size <= file_header_size)
+			return false;
+
+		int descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (descriptor < 0)
+			return false;
+
+		if (ftruncate(descriptor, static_cast<off_t>(reserved_size)) != 0)
+		{
+			close(descriptor);
+			return false;
+		}
+
+		void *new_mapping = mmap(nullptr, reserved_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+		if (new_mapping == MAP_FAILED)
+		{
+			close(descriptor);
+			return false;
+		}
+
+		heap_storage = std::vector<char>();
+		mapping = static_cast<char *>(new_mapping);
+		mapping_size = reserved_size;
+		file_descriptor = descriptor;
+		cells = mapping + file_header_size + (mapping_size - file_header_size)/2;
+		cells_count = 0;
+
+		return true;
+#else
+		(void)path;
+		(void)reserved_size;
+		return false;
+#endif
+	}
+
+	/*
+	 * Cells in range [keep_begin, keep_end) stay in place, their offset and size are written to file header,
+	 * and file is truncated right after them. Region between header and kept cells is punched out where it's
+	 * supported (Linux), so it doesn't take disk space. Storage becomes empty heap storage.
+	 */
+	void TapeStorage::unmapFile(size_t keep_begin, size_t keep_end, bool keep_data)
+	{
+#ifdef TM_TAPE_STORAGE_MAPPING_SUPPORTED
+		if (!isFileMapped())
+			return;
+
+		size_t kept_offset = static_cast<size_t>(cells - mapping) + keep_begin;
+		size_t kept_size = keep_data ? keep_end - keep_begin : 0;
+		if (keep_data)
+		{
+			std::ostringstream header;
+			header.write(FileHeaderSignature, sizeof(FileHeaderSignature));
+			writeBinary(header, FileHeaderVersion);
+			writeBinary(header, static_cast<uint64_t>(kept_offset));
+			writeBinary(header, static_cast<uint64_t>(kept_size));
+
+			const std::string header_data = header.str();
+			std::memset(mapping, 0, file_header_size);
+			std::memcpy(mapping, header_data.data(), header_data.size());
+		}
+
+		munmap(mapping, mapping_size);
+		if (keep_data)
+		{
+			// If truncation or punching fails nothing could be done, file just takes more disk space
+			[[maybe_unused]] int result = ftruncate(file_descriptor, static_cast<off_t>(kept_offset + kept_size));
+	#if defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+			if (kept_offset > file_header_size)
+				result = fallocate(file_descriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(file_header_size), static_cast<off_t>(kept_offset - file_header_size));
+	#endif
+		}
+		close(file_descriptor);
+
+		mapping = nullptr;
+		mapping_size = 0;
+		file_descriptor = -1;
+		cells = nullptr;
+		cells_count = 0;
+#else
+		(void)keep_begin;
+		(void)keep_end;
+		(void)keep_data;
+#endif
+	}
+
+	void TapeStorage::allocate(size_t size, char fill_symbol)
+	{
+		if (!isFileMapped())
+		{
+			std::vector<char> new_storage(size, fill_symbol);
+			heap_storage = std::move(new_storage);
+
+			cells = heap_storage.data();
+			cells_count = heap_storage.size();
+			return;
+		}
+
+		// Mapped window is centered, so tape could grow in both directions
+		size_t cells_space = mapping_size - file_header_size;
+		size_t window_size = std::min(size, cells_space);
+		cells = mapping + file_header_size + (cells_space - window_size)/2;
+		cells_count = window_size;
+		std::memset(cells, fill_symbol, cells_count);
+	}
+
+	/*
+	 * Heap storage grows in both directions (old cells are placed in the middle), mapped storage extends window
+	 * only in the requested direction. Growth is clamped, so size never exceeds max_size. Heap storage holds both old and
+	 * new cells during growth, so their total size is clamped instead.
+	 * Shift is the new index of the cell that had index 0 before growth.
+	 */
+	bool TapeStorage::grow(size_t growth_policy, bool backward, char fill_symbol, size_t max_size, size_t &shift)
+	{
+		if (!isFileMapped())
+		{
+			size_t max_growth_size = max_size/2 > cells_count ? max_size - cells_count*2 : 0;
+			size_t growth_size = std::min(cells_count*(growth_policy - 1), max_growth_size)/2;
+			if (growth_size == 0)
+				return false;
+
+			std::vector<char> new_storage(cells_count + growth_size*2, fill_symbol);
+			std::memcpy(new_storage.data() + growth_size, cells, cells_count);
+			heap_storage = std::move(new_storage);
+
+			cells = heap_storage.data();
+			cells_count = heap_storage.size();
+			shift = growth_size;
+
+			return true;
+		}
+
+		size_t max_growth_size = max_size > cells_count ? max_size - cells_count : 0;
+		size_t space_before = static_cast<size_t>(cells - mapping) - file_header_size;
+		size_t space_after = static_cast<size_t>(mapping + mapping_size - (cells + cells_count));
+
+		// Window contains the middle of mapping, so when one side is exhausted, window takes at least half of mapping.
+		// It's moved to the opposite end once, then the next growth takes all remaining space, so tape that grows only
+		// in one direction could use the whole reserved size. Indices are relative to window, so shift is not affected.
+		if ((backward ? space_before : space_after) == 0 && (backward ? space_after : space_before) != 0)
+		{
+			char *new_cells = backward ? mapping + mapping_size - cells_count : mapping + file_header_size;
+			std::memmove(new_cells, cells, cells_count);
+			cells = new_cells;
+			std::swap(space_before, space_after);
+		}
+
+		size_t growth_size = std::min(cells_count*(growth_policy - 1), max_growth_size);
+		if (backward)
+		{
+			growth_size = std::min(growth_size, space_before);
+			cells -= growth_size;
+			std::memset(cells, fill_symbol, growth_size);
+			shift = growth_size;
+		}
+		else
+		{
+			growth_size = std::min(growth_size, space_after);
+			std::memset(cells + cells_count, fill_symbol, growth_size);
+			shift = 0;
+		}
+
+		cells_count += growth_size;
+		return growth_size != 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef TM_TAPE_STORAGE_INCLUDED
+#define TM_TAPE_STORAGE_INCLUDED
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace TM
+{
+	/*
+	 * Memory that holds tape cells. By default cells live in heap and are reallocated on each growth.
+	 * Alternatively, storage could be backed by sparse memory-mapped file: whole reserved size is mapped once,
+	 * and growth only extends used window of the mapping, so no copy is performed and OS could page out cold regions.
+	 *
+	 * The first file_header_size bytes of file are reserved for header, that is written when file is unmapped:
+	 * signature "TMTF", format version (uint32_t), offset and size of kept cells in file (both uint64_t, host byte
+	 * order). Cells are left in place, so result could be read directly from file without any export step.
+	 */
+	class TapeStorage
+	{
+		public:
+			constexpr static size_t file_header_size = 4096;
+
+		private:
+			std::vector<char> heap_storage;
+
+			char *mapping;
+			size_t mapping_size;
+			int file_descriptor;
+
+			char *cells;
+			size_t cells_count;
+
+		public:
+			TapeStorage() : mapping(nullptr), mapping_size(0), file_descriptor(-1), cells(nullptr), cells_count(0) {}
+			TapeStorage(const TapeStorage &) = delete;
+			TapeStorage & operator=(const TapeStorage &) = delete;
+			~TapeStorage() { unmapFile(0, 0, false); }
+
+			bool mapFile(const std::string &path, size_t reserved_size);
+			void unmapFile(size_t keep_begin, size_t keep_end, bool keep_data = true);
+			bool isFileMapped() const { return mapping != nullptr; }
+
+			void allocate(size_t size, char fill_symbol);
+			bool grow(size_t growth_policy, bool backward, char fill_symbol, size_t max_size, size_t &shift);
+
+			char & operator[](size_t index) { return cells[index]; }
+			char operator[](size_t index) const { return cells[index]; }
+			char * data() { return cells; }
+			const char * data() const { return cells; }
+			size_t size() const { return cells_count; }
+	};
+}
+
+#endif // TM_TAPE_STORAGE_INCLUDED
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "TimeTravelDebugger.hpp"
+
+#include <algorithm>
+
+namespace TM
+{
+	TimeTravelDebugger::TimeTravelDebugger(const TuringProgram &program, Tape &tape, size_t snapshot_interval, size_t memory_budget) :
+		tape(tape),
+		turing_machine(program, tape),
+		snapshots_size(0),
+		snapshot_interval(std::max<size_t>(snapshot_interval, 1)),
+		memory_budget(memory_budget)
+	{
+		takeSnapshot();
+	}
+
+	void TimeTravelDebugger::takeSnapshot()
+	{
+		bool is_first_snapshot = snapshots.empty();
+
+		TuringMachine::Snapshot &snapshot = snapshots[getCurrentStep()];
+		turing_machine.takeSnapshot(snapshot, is_first_snapshot);
+		snapshots_size += getSnapshotSize(snapshot);
+
+		if (snapshots_size > memory_budget)
+			thinOutSnapshots();
+	}
+
+	/*
+	 * Snapshots are kept only on multiples of interval, so doubling it removes every second one. Removed snapshot
+	 * is merged into the next one, as tape changes of the next one are relative to it. The first snapshot is never
+	 * removed, it contains whole initial tape. The last one is kept too, next changes will be taken relative to it.
+	 */
+	void TimeTravelDebugger::thinOutSnapshots()
+	{
+		while (snapshots_size > memory_budget && snapshots.size() > 2)
+		{
+			snapshot_interval *= 2;
+			for (auto it = std::next(snapshots.begin()); std::next(it) != snapshots.end();)
+			{
+				auto next_it = std::next(it);
+				if (it->first % snapshot_interval == 0)
+				{
+					it = next_it;
+					continue;
+				}
+
+				TuringMachine::Snapshot &next_snapshot = next_it->second;
+				snapshots_size -= getSnapshotSize(it->second) + getSnapshotSize(next_snapshot);
+
+				it->second.tape_changes.merge(next_snapshot.tape_changes);
+				next_snapshot.tape_changes = std::move(it->second.tape_changes);
+				snapshots_size += getSnapshotSize(next_snapshot);
+
+				snapshots.erase(it);
+				it = next_it;
+			}
+		}
+	}
+
+	bool TimeTravelDebugger::runForward(size_t steps_count, std::string &error_description)
+	{
+		const size_t target_step = getCurrentStep() + steps_count;
+		while (getCurrentStep() < target_step)
+		{
+			size_t current_step = getCurrentStep();
+			size_t next_snapshot_step = (current_step/snapshot_interval + 1)*snapshot_interval;
+			if (!turing_machine.execute(error_description, std::min(target_step, next_snapshot_step) - current_step, false))
+				return false;
+
+			if (turing_machine.isHalted())
+			{
+				if (getCurrentStep() == target_step)
+					return true;
+
+				error_description = "Runtime error: execution is halted at step " + std::to_string(getCurrentStep());
+				return false;
+			}
+
+			// Replay after going back passes already existing snapshots, they are not taken again
+			if (getCurrentStep() % snapshot_interval == 0 && getCurrentStep() > snapshots.rbegin()->first)
+				takeSnapshot();
+		}
+
+		return true;
+	}
+
+	bool TimeTravelDebugger::stepForward(std::string &error_description, size_t steps_count)
+	{
+		return runForward(steps_count, error_description);
+	}
+
+	bool TimeTravelDebugger::stepBackward(std::string &error_description, size_t steps_count)
+	{
+		if (steps_count > getCurrentStep())
+		{
+			error_description = "Runtime error: unable to step back before step 0";
+			return false;
+		}
+
+		return goToStep(getCurrentStep() - steps_count, error_description);
+	}
+
+	bool TimeTravelDebugger::goToStep(size_t step, std::string &error_description)
+	{
+		if (step >= getCurrentStep())
+			return runForward(step - getCurrentStep(), error_description);
+
+		auto target_it = std::prev(snapshots.upper_bound(step));
+		tape.reset(tape.getDefaultSymbol());
+		for (auto it = snapshots.begin(); it != std::next(target_it); ++it)
+		{
+			if (!turing_machine.restoreSnapshot(it->second))
+			{
+				error_description = "Runtime error: unable to restore snapshot, tape storage is exhausted";
+				return false;
+			}
+		}
+
+		return runForward(step - target_it->first, error_description);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef TM_TIME_TRAVEL_DEBUGGER_INCLUDED
+#define TM_TIME_TRAVEL_DEBUGGER_INCLUDED
+
+#include <Tape.hpp>
+#include <Program.hpp>
+#include <TuringMachine.hpp>
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+namespace TM
+{
+	/*
+	 * Executes program, taking snapshots every snapshot interval steps, so any step could be reached by restoring
+	 * the nearest previous snapshot and replaying at most one interval forward. Only the first snapshot contains
+	 * whole tape, others contain cells touched by head since previous one, so each costs O(interval) memory.
+	 * Snapshot is restored by applying all snapshots up to it to reset tape, that costs O(memory budget) at most.
+	 * If snapshots exceed memory budget, every second one is merged into the next one and interval is doubled.
+	 */
+	class TimeTravelDebugger
+	{
+		public:
+			constexpr static size_t default_snapshot_interval = 1 << 20;
+			constexpr static size_t default_memory_budget = 256 << 20;
+
+		private:
+			Tape &tape;
+			TuringMachine turing_machine;
+
+			std::map<size_t, TuringMachine::Snapshot> snapshots;
+			size_t snapshots_size;
+			size_t snapshot_interval;
+			size_t memory_budget;
+
+			static size_t getSnapshotSize(const TuringMachine::Snapshot &snapshot) { return sizeof(snapshot) + snapshot.tape_changes.getCellsCount(); }
+
+			void takeSnapshot();
+			void thinOutSnapshots();
+			bool runForward(size_t steps_count, std::string &error_description);
+
+		public:
+			TimeTravelDebugger(const TimeTravelDebugger &) = delete;
+			TimeTravelDebugger & operator=(const TimeTravelDebugger &) = delete;
+
+			// Current configuration of machine and tape is used as step 0
+			TimeTravelDebugger(const TuringProgram &program, Tape &tape, size_t snapshot_interval = default_snapshot_interval, size_t memory_budget = default_memory_budget);
+
+			bool stepForward(std::string &error_description, size_t steps_count = 1);
+			bool stepBackward(std::string &error_description, size_t steps_count = 1);
+			bool goToStep(size_t step, std::string &error_description);
+
+			size_t getCurrentStep() const { return turing_machine.getStepsCount(); }
+			size_t getSnapshotInterval() const { return snapshot_interval; }
+			size_t getSnapshotsCount() const { return snapshots.size(); }
+			size_t getSnapshotsSize() const { return snapshots_size; }
+
+			TuringMachine & getMachine() { return turing_machine; }
+			const TuringMachine & getMachine() const { return turing_machine; }
+	};
+}
+
+#endif // TM_TIME_TRAVEL_DEBUGGER_INCLUDED
\ No newline at end of file
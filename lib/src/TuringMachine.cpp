@@ -1,17 +1,49 @@
 #include "TuringMachine.hpp"
+#include "Serialization.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr char CheckpointSignature[4] = { 'T', 'M', 'C', 'P' };
+static constexpr uint32_t CheckpointVersion = 1;
 
 namespace TM
 {
+	/*
+	 * Deadline and cancellation token are checked only once per check interval, because clock is relatively expensive
+	 */
+	bool TuringMachine::checkLimits(std::string &error_description)
+	{
+		if (limits.cancellation_token != nullptr && limits.cancellation_token->load(std::memory_order_relaxed))
+		{
+			last_error = ExecutionError::Cancelled;
+			error_description = "Runtime error: execution is cancelled";
+			return false;
+		}
+
+		if (limits.deadline != ExecutionLimits::Clock::time_point::max() && ExecutionLimits::Clock::now() >= limits.deadline)
+		{
+			last_error = ExecutionError::DeadlineExceeded;
+			error_description = "Runtime error: execution deadline exceeded";
+			return false;
+		}
+
+		return true;
+	}
+
 	bool TuringMachine::execute(std::string &error_description, size_t iterations_limit, bool error_on_iterations_limit_exceed)
 	{
+		last_error = ExecutionError::NoError;
 		if (is_halted)
 		{
+			last_error = ExecutionError::Halted;
 			error_description = "Runtime error: execution is halted";
 			return false;
 		}
 
 		if (!program.isValid())
 		{
+			last_error = ExecutionError::InvalidProgram;
 			error_description = "Runtime error: program is invalid";
 			return false;
 		}
@@ -19,37 +51,185 @@ namespace TM
 		if (current_state.isNull())
 			current_state = program.getInitialState();
 
+		if (!checkLimits(error_description))
+			return false;
+
+		const size_t check_interval = std::max<size_t>(limits.check_interval, 1);
+		size_t steps_before_check = check_interval;
 		for (size_t i = 0; i < iterations_limit; i++)
 		{
+			if (--steps_before_check == 0)
+			{
+				if (!checkLimits(error_description))
+					return false;
+
+				steps_before_check = check_interval;
+			}
+
 			char &current_symbol = tape.getCurrentSymbol();
 
 			TuringProgram::Action action;
 			if (!program.findStateAction(current_state, current_symbol, action))
 			{
 				std::string state_name = program.getStateName(current_state);
+				last_error = ExecutionError::MissingAction;
 				error_description = "Runtime error: state named \"" + state_name + "\" doesn't have entry for symbol \'" + current_symbol + "\'";
 
 				return false;
 			}
 
+			if (transitions_counts != nullptr)
+				(*transitions_counts)[program.getStateIndex(current_state)*256 + static_cast<unsigned char>(current_symbol)]++;
+
 			if (action.replace_symbol)
 				current_symbol = action.new_symbol;
 
-			tape.moveHead(action.offset);
+			if (!tape.moveHead(action.offset))
+			{
+				if (tape.isStorageLimitReached())
+				{
+					last_error = ExecutionError::TapeBytesLimitExceeded;
+					error_description = "Runtime error: exceed tape memory limit (set to " + std::to_string(tape.getStorageLimit()) + " bytes)";
+				}
+				else
+				{
+					last_error = ExecutionError::TapeStorageExhausted;
+					error_description = "Runtime error: tape storage is exhausted";
+				}
+
+				return false;
+			}
+
 			current_state = action.new_state;
+			steps_count++;
 			if (action.is_final_state)
 			{
 				is_halted = true;
 				return true;
 			}
+
+			// Tape grows at most by one cell per step, so limit is never exceeded by more than one cell
+			if (tape.size() > limits.max_tape_cells)
+			{
+				last_error = ExecutionError::TapeCellsLimitExceeded;
+				error_description = "Runtime error: exceed tape cells limit (set to " + std::to_string(limits.max_tape_cells) + ")";
+				return false;
+			}
 		}
 
 		if (error_on_iterations_limit_exceed)
 		{
+			last_error = ExecutionError::IterationsLimitExceeded;
 			error_description = "Runtime error: exceed maximum iterations limit (set to " + std::to_string(iterations_limit) + ")";
 			return false;
 		}
 
 		return true;
 	}
+
+	/*
+	 */
+	void TuringMachine::saveCheckpoint(std::ostream &output) const
+	{
+		output.write(CheckpointSignature, sizeof(CheckpointSignature));
+		writeBinary(output, CheckpointVersion);
+		writeBinary(output, program.getFingerprint());
+		writeBinary(output, static_cast<uint64_t>(program.getStatesCount()));
+		writeBinary(output, static_cast<uint64_t>(program.getStateIndex(current_state)));
+		writeBinary(output, static_cast<uint8_t>(is_halted));
+		writeBinary(output, static_cast<uint64_t>(steps_count));
+		tape.save(output);
+	}
+
+	size_t TuringMachine::getCheckpointSize() const
+	{
+		return sizeof(CheckpointSignature) + sizeof(CheckpointVersion) + sizeof(uint64_t)*3 + sizeof(uint8_t) + sizeof(uint64_t) + tape.getSavedSize();
+	}
+
+	bool TuringMachine::loadCheckpoint(std::istream &input, std::string &error_description)
+	{
+		if (!program.isValid())
+		{
+			error_description = "Checkpoint error: program is invalid";
+			return false;
+		}
+
+		char signature[sizeof(CheckpointSignature)];
+		uint32_t version;
+		if (!input.read(signature, sizeof(signature)) || std::memcmp(signature, CheckpointSignature, sizeof(signature)) != 0 || !readBinary(input, version))
+		{
+			error_description = "Checkpoint error: data is not a checkpoint";
+			return false;
+		}
+
+		if (version != CheckpointVersion)
+		{
+			error_description = "Checkpoint error: unsupported checkpoint version " + std::to_string(version);
+			return false;
+		}
+
+		uint64_t fingerprint;
+		uint64_t states_count;
+		uint64_t state_index;
+		uint8_t halted;
+		uint64_t saved_steps_count;
+
+		bool success =
+			readBinary(input, fingerprint) &&
+			readBinary(input, states_count) &&
+			readBinary(input, state_index) &&
+			readBinary(input, halted) &&
+			readBinary(input, saved_steps_count);
+
+		if (!success)
+		{
+			error_description = "Checkpoint error: unexpected end of data";
+			return false;
+		}
+
+		if (fingerprint != program.getFingerprint() || states_count != program.getStatesCount())
+		{
+			error_description = "Checkpoint error: checkpoint was created by another program";
+			return false;
+		}
+
+		StateHandle state = program.getStateByIndex(static_cast<size_t>(state_index));
+		if (state.isNull() && !halted)
+		{
+			error_description = "Checkpoint error: invalid state index " + std::to_string(state_index);
+			return false;
+		}
+
+		if (!tape.load(input))
+		{
+			error_description = "Checkpoint error: tape data is corrupted";
+			return false;
+		}
+
+		current_state = state;
+		is_halted = halted != 0;
+		steps_count = static_cast<size_t>(saved_steps_count);
+
+		return true;
+	}
+
+	void TuringMachine::takeSnapshot(Snapshot &snapshot, bool all_visited_cells)
+	{
+		snapshot.state = current_state;
+		snapshot.is_halted = is_halted;
+		snapshot.steps_count = steps_count;
+		tape.takeChanges(snapshot.tape_changes, all_visited_cells);
+	}
+
+	bool TuringMachine::restoreSnapshot(const Snapshot &snapshot)
+	{
+		if (!tape.applyChanges(snapshot.tape_changes))
+			return false;
+
+		current_state = snapshot.state;
+		is_halted = snapshot.is_halted;
+		steps_count = snapshot.steps_count;
+
+		return true;
+	}
 }
\ No newline at end of file
@@ -4,18 +4,77 @@
 #include <Tape.hpp>
 #include <Program.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <istream>
+#include <limits>
+#include <ostream>
 #include <string>
+#include <vector>
 
 namespace TM
 {
+	/*
+	 * Resource limits of execution, each one ends execution with its own error when exceeded.
+	 * Tape memory limit is applied to the tape itself, see Tape::setStorageLimit().
+	 */
+	struct ExecutionLimits
+	{
+		using Clock = std::chrono::steady_clock;
+
+		size_t max_tape_cells = std::numeric_limits<size_t>::max();
+		Clock::time_point deadline = Clock::time_point::max();
+		const std::atomic<bool> *cancellation_token = nullptr;
+
+		// Deadline and cancellation token are checked once per this number of steps
+		size_t check_interval = 1 << 16;
+	};
+
+	enum class ExecutionError
+	{
+		NoError,
+
+		Halted,
+		InvalidProgram,
+		MissingAction,
+		IterationsLimitExceeded,
+		TapeStorageExhausted,
+		TapeCellsLimitExceeded,
+		TapeBytesLimitExceeded,
+		DeadlineExceeded,
+		Cancelled,
+	};
+
 	class TuringMachine
 	{
+		public:
+			/*
+			 * In-memory snapshot of machine configuration. Tape is stored as changes since previous snapshot
+			 * (see Tape::Changes), so snapshots are restored by applying them in order to reset tape.
+			 */
+			struct Snapshot
+			{
+				StateHandle state;
+				bool is_halted = false;
+				size_t steps_count = 0;
+				Tape::Changes tape_changes;
+			};
+
 		private:
 			const TuringProgram &program;
 			Tape &tape;
 
 			StateHandle current_state;
 			bool is_halted;
+			size_t steps_count;
+
+			ExecutionLimits limits;
+			ExecutionError last_error;
+
+			std::vector<uint64_t> *transitions_counts;
+
+			bool checkLimits(std::string &error_description);
 
 		public:
 			TuringMachine(const TuringMachine &) = delete;
@@ -27,7 +86,10 @@ namespace TM
 				program(program),
 				tape(tape),
 				current_state(program.getInitialState()),
-				is_halted(false)
+				is_halted(false),
+				steps_count(0),
+				last_error(ExecutionError::NoError),
+				transitions_counts(nullptr)
 			{}
 
 			void resetState(bool clear_tape = true)
@@ -35,10 +97,33 @@ namespace TM
 				if (clear_tape) tape.reset();
 				current_state = program.getInitialState();
 				is_halted = false;
+				steps_count = 0;
 			}
 
 			bool execute(std::string &error_description, size_t iterations_limit, bool error_on_iterations_limit_exceed = true);
 			bool isHalted() const { return is_halted; }
+			StateHandle getCurrentState() const { return current_state; }
+			size_t getStepsCount() const { return steps_count; }
+			ExecutionError getLastError() const { return last_error; }
+
+			void setLimits(const ExecutionLimits &new_limits) { limits = new_limits; }
+			const ExecutionLimits & getLimits() const { return limits; }
+
+			// Makes machine count executed transitions (see TuringProgram::computeStatesOrder()), nullptr disables counting
+			void setTransitionsCounter(std::vector<uint64_t> *counts)
+			{
+				transitions_counts = counts;
+				if (transitions_counts != nullptr)
+					transitions_counts->resize(program.getStatesCount()*256, 0);
+			}
+
+			// Checkpoint contains machine state and tape, and could be loaded only with the same program
+			void saveCheckpoint(std::ostream &output) const;
+			size_t getCheckpointSize() const;
+			bool loadCheckpoint(std::istream &input, std::string &error_description);
+
+			void takeSnapshot(Snapshot &snapshot, bool all_visited_cells = false);
+			bool restoreSnapshot(const Snapshot &snapshot);
 	};
 }
 
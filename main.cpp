@@ -1,10 +1,36 @@
 #include <Tape.hpp>
 #include <Program.hpp>
 #include <TuringMachine.hpp>
+#include <LockstepExecutor.hpp>
+#include <TimeTravelDebugger.hpp>
 
+#include "ExecutionServer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define TM_CHECKPOINT_SYNC_SUPPORTED
+	#define TM_CHECKPOINT_FORK_SUPPORTED
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+#endif
 
 constexpr static const char *HelloWorldSourceCode =
 {
@@ -22,61 +48,987 @@ constexpr static const char *HelloWorldSourceCode =
 	"11 * ! r halt\n"
 };
 
-int main(int argc, char *argv[])
+constexpr static const char *UsageDescription =
 {
-	std::string source_code = HelloWorldSourceCode;
+	"Usage: libtest [options] [<path_to_program> [<begin_state_name> [<default_tape_symbol> [<tape_initial_data> [<iterations_limit>]]]]]\n"
+	"Options:\n"
+	"  -p, --program <path>      path to file with program source code\n"
+	"  -s, --state <name>        name of the initial state (default \"0\")\n"
+	"  -b, --blank <symbol>      symbol that fills empty tape cells (default '_')\n"
+	"  -i, --input <string>      data printed on tape before execution (default \"\")\n"
+	"  -l, --limit <count>       maximum iterations count (default 10000)\n"
+	"      --batch <path>        execute program once for each line of file ('-' for stdin)\n"
+	"      --lanes <count>       machines executed in lockstep in batch mode (0 to disable)\n"
+	"      --checkpoint <path>   periodically save execution checkpoint to file\n"
+	"      --checkpoint-interval <count>\n"
+	"                            iterations count between checkpoints (default 100000000)\n"
+	"      --resume <path>       resume execution from checkpoint file\n"
+	"      --tape-file <path>    keep tape in sparse memory-mapped file, which contains result tape after execution\n"
+	"      --tape-file-size <bytes>\n"
+	"                            maximum size of tape file (default 64 GiB on 64-bit systems)\n"
+	"      --max-tape-cells <count>\n"
+	"                            maximum count of visited tape cells\n"
+	"      --max-tape-bytes <bytes>\n"
+	"                            maximum memory used by tape (peak, including reallocation)\n"
+	"      --timeout <milliseconds>\n"
+	"                            maximum execution time (of each input in batch mode or job in server mode)\n"
+	"      --profile-output <path>\n"
+	"                            collect transitions counts and write hot-first states order to file\n"
+	"      --states-order <path> reorder states of compiled program according to file\n"
+	"      --server              launch execution server on stdin/stdout\n"
+	"      --workers <count>     worker threads count for server mode\n"
+	"      --debug               execute program step by step, commands are read from stdin\n"
+	"      --snapshot-interval <count>\n"
+	"                            iterations count between debugger snapshots (default 1048576)\n"
+	"      --snapshot-budget <bytes>\n"
+	"                            maximum memory used by debugger snapshots (default 256 MiB)\n"
+	"  -h, --help                show this message\n"
+	"Arguments after \"--\" and arguments that look like negative numbers are always positional.\n"
+};
+
+struct Options
+{
+	std::string program_path = "";
 	std::string begin_state_name = "0";
 	char default_tape_symbol = '_';
 	std::string tape_initial_data = "";
 	size_t program_iteration_limit = 10000;
 
-	switch (argc)
+	std::string batch_input_path = "";
+	size_t batch_lanes_count = 0;
+	std::string checkpoint_path = "";
+	size_t checkpoint_interval = 100000000;
+	std::string resume_path = "";
+	std::string tape_file_path = "";
+	size_t tape_file_size = TM::Tape::default_file_reserved_size;
+	size_t max_tape_cells = std::numeric_limits<size_t>::max();
+	size_t max_tape_bytes = std::numeric_limits<size_t>::max();
+	size_t timeout_milliseconds = 0;
+	std::string profile_output_path = "";
+	std::string states_order_path = "";
+	bool server_mode = false;
+	size_t server_workers_count = std::thread::hardware_concurrency();
+	bool debug_mode = false;
+	size_t snapshot_interval = TM::TimeTravelDebugger::default_snapshot_interval;
+	size_t snapshot_budget = TM::TimeTravelDebugger::default_memory_budget;
+};
+
+static bool parseCount(const std::string &value, size_t &output_count)
+{
+	size_t parsed_size = 0;
+	try
+	{
+		output_count = std::stoull(value, &parsed_size);
+	}
+	catch (const std::exception &)
+	{
+		return false;
+	}
+
+	return parsed_size != 0 && parsed_size == value.size() && value[0] != '-';
+}
+
+/*
+ * Each mode honors only part of options, so options that would be silently ignored are rejected.
+ * Options are identified by their long names, positional arguments by names of corresponding flags.
+ */
+static bool checkOptionsCompatibility(const Options &options, const std::vector<std::string> &specified_options, std::string &error_description)
+{
+	static const std::vector<std::string> ServerOptions = { "--server", "--workers", "--max-tape-cells", "--max-tape-bytes", "--timeout" };
+	static const std::vector<std::string> BatchIgnoredOptions = { "--input", "--checkpoint", "--checkpoint-interval", "--resume", "--tape-file", "--tape-file-size", "--debug" };
+	static const std::vector<std::string> DebuggerIgnoredOptions = { "--limit", "--checkpoint", "--checkpoint-interval", "--resume", "--profile-output" };
+	static const std::vector<std::pair<std::string, std::string>> RequiredOptions =
+	{
+		{ "--workers", "--server" },
+		{ "--lanes", "--batch" },
+		{ "--checkpoint-interval", "--checkpoint" },
+		{ "--tape-file-size", "--tape-file" },
+		{ "--snapshot-interval", "--debug" },
+		{ "--snapshot-budget", "--debug" },
+	};
+
+	// Mapped tape is shared with checkpoint process instead of being copied, and loaded tape is built in heap
+	static const std::vector<std::pair<std::string, std::string>> ConflictingOptions =
+	{
+		{ "--checkpoint", "--tape-file" },
+		{ "--resume", "--tape-file" },
+	};
+
+	auto contains = [](const std::vector<std::string> &names, const std::string &name)
 	{
-		case 6:
-			program_iteration_limit = std::stoull(argv[5]);
-		case 5:
-			tape_initial_data = argv[4];
-		case 4:
-			default_tape_symbol = argv[3][0];
-		case 3:
-			begin_state_name = argv[2];
-		case 2:
+		return std::find(names.begin(), names.end(), name) != names.end();
+	};
+
+	for (const std::string &name : specified_options)
+	{
+		std::string mode_name;
+		if (options.server_mode && !contains(ServerOptions, name))
+			mode_name = "server mode";
+		else if (!options.batch_input_path.empty() && contains(BatchIgnoredOptions, name))
+			mode_name = "batch mode";
+		else if (options.debug_mode && contains(DebuggerIgnoredOptions, name))
+			mode_name = "debugger";
+
+		if (!mode_name.empty())
+		{
+			error_description = "option \"" + name + "\" couldn't be used together with " + mode_name;
+			return false;
+		}
+
+		for (const auto & [option, required_option] : RequiredOptions)
+		{
+			if (name == option && !contains(specified_options, required_option))
+			{
+				error_description = "option \"" + name + "\" requires \"" + required_option + "\"";
+				return false;
+			}
+		}
+
+		for (const auto & [option, conflicting_option] : ConflictingOptions)
 		{
-			std::ifstream program_source_code_file(argv[1]);
-			if (!program_source_code_file.is_open())
+			if (name == option && contains(specified_options, conflicting_option))
 			{
-				std::cout << "Unable to load program source code" << std::endl;
-				return -1;
+				error_description = "option \"" + name + "\" couldn't be used together with \"" + conflicting_option + "\"";
+				return false;
 			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Options could be set by flags in any order. Arguments without flag are treated as
+ * positional and assigned in the same order as in previous versions of the tool.
+ */
+static bool parseOptions(int argc, char *argv[], Options &options, std::string &error_description)
+{
+	static const std::unordered_map<std::string, std::string> ShortOptions =
+	{
+		{ "-p", "--program" }, { "-s", "--state" }, { "-b", "--blank" }, { "-i", "--input" }, { "-l", "--limit" },
+	};
+	static const std::vector<std::string> PositionalOptions = { "--program", "--state", "--blank", "--input", "--limit" };
 
-			std::cout << "Loaded program source code\n\n";
+	std::vector<std::string> specified_options;
+	size_t positional_index = 0;
+	bool options_finished = false;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument = argv[i];
+		if (argument == "--" && !options_finished)
+		{
+			options_finished = true;
+			continue;
+		}
 
-			source_code.clear();
-			for (std::string file_input; !program_source_code_file.eof(); source_code += '\n')
+		// Negative numbers (and everything after "--") are positional arguments, not options
+		const bool is_option = !options_finished && argument.size() > 1 && argument[0] == '-' && !std::isdigit(static_cast<unsigned char>(argument[1]));
+		if (is_option)
+		{
+			auto it = ShortOptions.find(argument);
+			specified_options.push_back(it != ShortOptions.end() ? it->second : argument);
+		}
+		else if (positional_index < PositionalOptions.size())
+			specified_options.push_back(PositionalOptions[positional_index]);
+
+		auto nextValue = [&](std::string &value) -> bool
+		{
+			if (i + 1 >= argc)
+			{
+				error_description = "option \"" + argument + "\" requires value";
+				return false;
+			}
+
+			value = argv[++i];
+			return true;
+		};
+
+		std::string value;
+		if (!is_option)
+		{
+			switch (positional_index++)
+			{
+				case 0:
+					options.program_path = argument;
+					break;
+
+				case 1:
+					options.begin_state_name = argument;
+					break;
+
+				case 2:
+					options.default_tape_symbol = argument[0];
+					break;
+
+				case 3:
+					options.tape_initial_data = argument;
+					break;
+
+				case 4:
+					if (!parseCount(argument, options.program_iteration_limit))
+					{
+						error_description = "\"" + argument + "\" is not a valid iterations limit";
+						return false;
+					}
+					break;
+
+				default:
+					error_description = "unexpected argument \"" + argument + "\"";
+					return false;
+			}
+		}
+		else if (argument == "-h" || argument == "--help")
+		{
+			error_description = "";
+			return false;
+		}
+		else if (argument == "--server")
+			options.server_mode = true;
+		else if (argument == "--debug")
+			options.debug_mode = true;
+		else if (argument == "-p" || argument == "--program")
+		{
+			if (!nextValue(options.program_path))
+				return false;
+		}
+		else if (argument == "-s" || argument == "--state")
+		{
+			if (!nextValue(options.begin_state_name))
+				return false;
+		}
+		else if (argument == "-b" || argument == "--blank")
+		{
+			if (!nextValue(value))
+				return false;
+
+			if (value.size() != 1)
+			{
+				error_description = "default tape symbol must be exactly one symbol";
+				return false;
+			}
+			options.default_tape_symbol = value[0];
+		}
+		else if (argument == "-i" || argument == "--input")
+		{
+			if (!nextValue(options.tape_initial_data))
+				return false;
+		}
+		else if (argument == "-l" || argument == "--limit")
+		{
+			if (!nextValue(value))
+				return false;
+
+			if (!parseCount(value, options.program_iteration_limit))
+			{
+				error_description = "\"" + value + "\" is not a valid iterations limit";
+				return false;
+			}
+		}
+		else if (argument == "--batch")
+		{
+			if (!nextValue(options.batch_input_path))
+				return false;
+		}
+		else if (argument == "--lanes")
+		{
+			if (!nextValue(value))
+				return false;
+
+			if (!parseCount(value, options.batch_lanes_count))
 			{
-				std::getline(program_source_code_file, file_input);
-				source_code += file_input;
+				error_description = "\"" + value + "\" is not a valid lanes count";
+				return false;
 			}
-			program_source_code_file.close();
 		}
+		else if (argument == "--checkpoint")
+		{
+			if (!nextValue(options.checkpoint_path))
+				return false;
+		}
+		else if (argument == "--checkpoint-interval")
+		{
+			if (!nextValue(value))
+				return false;
+
+			if (!parseCount(value, options.checkpoint_interval) || options.checkpoint_interval == 0)
+			{
+				error_description = "\"" + value + "\" is not a valid checkpoint interval";
+				return false;
+			}
+		}
+		else if (argument == "--resume")
+		{
+			if (!nextValue(options.resume_path))
+				return false;
+		}
+		else if (argument == "--tape-file")
+		{
+			if (!nextValue(options.tape_file_path))
+				return false;
+		}
+		else if (argument == "--tape-file-size")
+		{
+			if (!nextValue(value))
+				return false;
+
+			if (!parseCount(value, options.tape_file_size))
+			{
+				error_description = "\"" + value + "\" is not a valid tape file size";
+				return false;
+			}
+		}
+		else if (argument == "--max-tape-cells" || argument == "--max-tape-bytes" || argument == "--timeout")
+		{
+			if (!nextValue(value))
+				return false;
+
+			size_t &limit = argument == "--max-tape-cells" ? options.max_tape_cells : argument == "--max-tape-bytes" ? options.max_tape_bytes : options.timeout_milliseconds;
+			if (!parseCount(value, limit) || limit == 0)
+			{
+				error_description = "\"" + value + "\" is not a valid value of \"" + argument + "\"";
+				return false;
+			}
+		}
+		else if (argument == "--profile-output")
+		{
+			if (!nextValue(options.profile_output_path))
+				return false;
+		}
+		else if (argument == "--states-order")
+		{
+			if (!nextValue(options.states_order_path))
+				return false;
+		}
+		else if (argument == "--workers")
+		{
+			if (!nextValue(value))
+				return false;
+
+			if (!parseCount(value, options.server_workers_count))
+			{
+				error_description = "\"" + value + "\" is not a valid workers count";
+				return false;
+			}
+		}
+		else if (argument == "--snapshot-interval")
+		{
+			if (!nextValue(value))
+				return false;
+
+			if (!parseCount(value, options.snapshot_interval) || options.snapshot_interval == 0)
+			{
+				error_description = "\"" + value + "\" is not a valid snapshot interval";
+				return false;
+			}
+		}
+		else if (argument == "--snapshot-budget")
+		{
+			if (!nextValue(value))
+				return false;
+
+			if (!parseCount(value, options.snapshot_budget))
+			{
+				error_description = "\"" + value + "\" is not a valid snapshot budget";
+				return false;
+			}
+		}
+		else
+		{
+			error_description = "unknown option \"" + argument + "\"";
+			return false;
+		}
+	}
+
+	if (options.batch_lanes_count != 0 && !options.profile_output_path.empty())
+	{
+		error_description = "profile couldn't be collected together with lanes";
+		return false;
+	}
+
+	return checkOptionsCompatibility(options, specified_options, error_description);
+}
+
+static std::atomic<bool> ExecutionCancelled = false;
+
+extern "C" void cancelExecution(int)
+{
+	ExecutionCancelled.store(true);
+}
+
+/*
+ * Deadline is calculated from the moment of the call, so limits should be made right before execution
+ */
+static TM::ExecutionLimits makeExecutionLimits(const Options &options, const std::atomic<bool> *cancellation_token = nullptr)
+{
+	TM::ExecutionLimits limits;
+	limits.max_tape_cells = options.max_tape_cells;
+	limits.cancellation_token = cancellation_token;
+	if (options.timeout_milliseconds != 0)
+		limits.deadline = TM::ExecutionLimits::Clock::now() + std::chrono::milliseconds(options.timeout_milliseconds);
+
+	return limits;
+}
+
+static bool loadSourceCode(const std::string &path, std::string &source_code)
+{
+	std::ifstream program_source_code_file(path);
+	if (!program_source_code_file.is_open())
+		return false;
+
+	source_code.clear();
+	for (std::string file_input; !program_source_code_file.eof(); source_code += '\n')
+	{
+		std::getline(program_source_code_file, file_input);
+		source_code += file_input;
+	}
+	program_source_code_file.close();
+
+	return true;
+}
+
+static constexpr size_t BatchOutputBufferFlushSize = 1 << 16;
+static constexpr size_t BatchLockstepChunkSize = 1 << 14;
+
+static void appendBatchResult(std::string &output_buffer, bool success, size_t steps_count, const char *tape, size_t tape_size, const std::string &error_description)
+{
+	output_buffer += success ? "halted\t" : "error\t";
+	output_buffer += std::to_string(steps_count);
+	output_buffer += '\t';
+	output_buffer.append(tape, tape_size);
+	if (!success)
+	{
+		output_buffer += '\t';
+		output_buffer += error_description;
+	}
+	output_buffer += '\n';
+
+	if (output_buffer.size() >= BatchOutputBufferFlushSize)
+	{
+		std::cout.write(output_buffer.data(), output_buffer.size());
+		output_buffer.clear();
+	}
+}
+
+static bool readBatchInput(std::istream &input, std::string &tape_initial_data)
+{
+	if (!std::getline(input, tape_initial_data))
+		return false;
+
+	if (!tape_initial_data.empty() && tape_initial_data.back() == '\r')
+		tape_initial_data.pop_back();
+
+	return true;
+}
+
+/*
+ * States order file contains state names, one per line, in the order they should be placed.
+ * States that are absent in file keep their relative order and are placed after all listed states.
+ */
+static bool writeStatesOrderFile(const TM::TuringProgram &program, const std::vector<uint64_t> &transitions_counts, const std::string &path)
+{
+	std::ofstream states_order_file(path);
+	if (!states_order_file.is_open())
+		return false;
+
+	for (size_t state_index : program.computeStatesOrder(transitions_counts))
+		states_order_file << program.getStateName(program.getStateByIndex(state_index)) << '\n';
+
+	return static_cast<bool>(states_order_file);
+}
+
+static bool applyStatesOrderFile(TM::TuringProgram &program, const std::string &path)
+{
+	std::ifstream states_order_file(path);
+	if (!states_order_file.is_open())
+		return false;
+
+	std::unordered_map<std::string, size_t> states_indices;
+	for (size_t state_index = 0; state_index < program.getStatesCount(); state_index++)
+		states_indices.insert({ program.getStateName(program.getStateByIndex(state_index)), state_index });
+
+	// Initial state must always be the first one
+	std::vector<bool> is_placed(program.getStatesCount(), false);
+	std::vector<size_t> order = { 0 };
+	is_placed[0] = true;
+
+	for (std::string state_name; std::getline(states_order_file, state_name);)
+	{
+		auto it = states_indices.find(state_name);
+		if (it != states_indices.end() && !is_placed[it->second])
+		{
+			order.push_back(it->second);
+			is_placed[it->second] = true;
+		}
+	}
+
+	for (size_t state_index = 0; state_index < program.getStatesCount(); state_index++)
+	{
+		if (!is_placed[state_index])
+			order.push_back(state_index);
+	}
+
+	return program.reorderStates(order);
+}
+
+/*
+ * Inputs are read by chunks, so results are streamed while whole input is never stored in memory
+ */
+static void executeBatchLockstep(const TM::TuringProgram &program, const Options &options, std::istream &input, std::string &output_buffer)
+{
+	TM::LockstepExecutor executor(program, options.default_tape_symbol, options.batch_lanes_count);
+	executor.setLimits(makeExecutionLimits(options), options.max_tape_bytes, std::chrono::milliseconds(options.timeout_milliseconds));
+
+	std::vector<std::string> inputs;
+	std::vector<TM::LockstepExecutor::Result> results;
+	for (bool have_input = true; have_input;)
+	{
+		inputs.clear();
+		for (std::string tape_initial_data; inputs.size() < BatchLockstepChunkSize && (have_input = readBatchInput(input, tape_initial_data));)
+			inputs.push_back(std::move(tape_initial_data));
+
+		executor.execute(inputs, options.program_iteration_limit, results);
+		for (const TM::LockstepExecutor::Result &result : results)
+			appendBatchResult(output_buffer, result.success, result.steps_count, result.tape.data(), result.tape.size(), result.error_description);
+	}
+}
+
+/*
+ * Compiles program once and executes it for each line of input, reusing the same tape and machine.
+ * Results are written as "<halted|error>\t<steps_count>\t<result_tape>[\t<error_description>]".
+ */
+static int executeBatch(const TM::TuringProgram &program, const Options &options, std::istream &input)
+{
+	std::string output_buffer;
+	if (options.batch_lanes_count != 0)
+		executeBatchLockstep(program, options, input, output_buffer);
+	else
+	{
+		TM::Tape tape(options.default_tape_symbol, "", 0, options.max_tape_bytes);
+		TM::TuringMachine turing_machine(program, tape);
+		turing_machine.setLimits(makeExecutionLimits(options));
+
+		std::vector<uint64_t> transitions_counts;
+		if (!options.profile_output_path.empty())
+			turing_machine.setTransitionsCounter(&transitions_counts);
+
+		std::string error_description;
+		for (std::string tape_initial_data; readBatchInput(input, tape_initial_data);)
+		{
+			tape.reset(options.default_tape_symbol, tape_initial_data);
+			turing_machine.resetState(false);
+
+			// Timeout is applied to each input separately
+			if (options.timeout_milliseconds != 0)
+				turing_machine.setLimits(makeExecutionLimits(options));
+
+			bool success = turing_machine.execute(error_description, options.program_iteration_limit);
+			tape.trimRedundantSpaces();
+
+			appendBatchResult(output_buffer, success, turing_machine.getStepsCount(), tape.getString(), tape.size(), error_description);
+		}
+
+		if (!options.profile_output_path.empty() && !writeStatesOrderFile(program, transitions_counts, options.profile_output_path))
+			std::cerr << "Unable to write states order file" << std::endl;
+	}
+
+	std::cout.write(output_buffer.data(), output_buffer.size());
+	std::cout.flush();
+
+	return 0;
+}
+
+/*
+ * Flushes file (or directory entries) to disk, so it survives system crash, not only process crash
+ */
+static bool syncToDisk(const std::filesystem::path &path)
+{
+#ifdef TM_CHECKPOINT_SYNC_SUPPORTED
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return false;
+
+	bool success = (fsync(descriptor) == 0);
+	close(descriptor);
+
+	return success;
+#else
+	(void)path;
+	return true;
+#endif
+}
+
+/*
+ * Checkpoint is written into temporary file first and then replaces previous one,
+ * so there is always at least one valid checkpoint on disk even if process is killed during write.
+ * Data of temporary file is synced before rename, otherwise rename could reach disk earlier than data,
+ * and directory is synced after rename, so new checkpoint survives system crash too.
+ */
+static bool writeCheckpointFile(const std::string &path, const std::function<void (std::ostream &)> &writeCheckpoint)
+{
+	const std::string temporary_path = path + ".tmp";
+
+	std::ofstream checkpoint_file(temporary_path, std::ios::binary | std::ios::trunc);
+	writeCheckpoint(checkpoint_file);
+	if (!checkpoint_file)
+		return false;
+
+	checkpoint_file.close();
+	if (!checkpoint_file || !syncToDisk(temporary_path))
+		return false;
+
+	std::error_code error;
+	std::filesystem::rename(temporary_path, path, error);
+	if (error)
+		return false;
+
+	std::filesystem::path directory_path = std::filesystem::path(path).parent_path();
+	return syncToDisk(directory_path.empty() ? std::filesystem::path(".") : directory_path);
+}
+
+/*
+ * Stream buffer that appends to string, so checkpoint is serialized right into reserved buffer without extra copy
+ */
+class StringAppendBuffer : public std::streambuf
+{
+	private:
+		std::string &output;
+
+	protected:
+		int_type overflow(int_type symbol) override
+		{
+			if (!traits_type::eq_int_type(symbol, traits_type::eof()))
+				output.push_back(traits_type::to_char_type(symbol));
+
+			return traits_type::not_eof(symbol);
+		}
+
+		std::streamsize xsputn(const char *data, std::streamsize size) override
+		{
+			output.append(data, static_cast<size_t>(size));
+			return size;
+		}
+
+	public:
+		explicit StringAppendBuffer(std::string &output) : output(output) {}
+};
+
+static void reportCheckpointFailure(const std::string &path)
+{
+	std::cerr << "Unable to write checkpoint to \"" << path << "\"" << std::endl;
+}
+
+#ifdef TM_CHECKPOINT_FORK_SUPPORTED
+/*
+ * Child process gets copy-on-write copy of memory, so it streams checkpoint straight from tape cells to file,
+ * while parent continues execution immediately. Only pages modified by parent meanwhile are actually copied.
+ */
+static bool startCheckpointProcess(const TM::TuringMachine &turing_machine, const std::string &path, pid_t &process_id)
+{
+	pid_t new_process_id = fork();
+	if (new_process_id < 0)
+		return false;
+
+	if (new_process_id == 0)
+	{
+		bool success = writeCheckpointFile(path, [&turing_machine](std::ostream &output) { turing_machine.saveCheckpoint(output); });
+		if (!success)
+			reportCheckpointFailure(path);
+
+		// Exit handlers and buffers belong to parent, so they are skipped
+		_exit(success ? 0 : 1);
+	}
+
+	process_id = new_process_id;
+	return true;
+}
+
+static void waitCheckpointProcess(pid_t &process_id)
+{
+	if (process_id < 0)
+		return;
+
+	int status;
+	while (waitpid(process_id, &status, 0) < 0 && errno == EINTR);
+	process_id = -1;
+}
+#endif
+
+/*
+ * Executes program in chunks of checkpoint interval size. On POSIX systems checkpoint is written by forked
+ * process from its copy-on-write snapshot of memory, so execution isn't paused for copying tape. Otherwise (or
+ * if fork fails) visited tape cells are serialized into exactly sized buffer, that is written to disk by separate
+ * thread while execution continues. Only one checkpoint is written at a time, so previous one is waited for first.
+ * Iterations limit is applied to total steps count, including steps made before resume.
+ */
+static bool executeWithCheckpoints(TM::TuringMachine &turing_machine, const Options &options, std::string &error_description)
+{
+	std::thread checkpoint_writer;
+#ifdef TM_CHECKPOINT_FORK_SUPPORTED
+	pid_t checkpoint_process_id = -1;
+#endif
+
+	auto waitCheckpointWriter = [&]()
+	{
+		if (checkpoint_writer.joinable())
+			checkpoint_writer.join();
+
+#ifdef TM_CHECKPOINT_FORK_SUPPORTED
+		waitCheckpointProcess(checkpoint_process_id);
+#endif
+	};
+
+	bool success = true;
+	while (!turing_machine.isHalted())
+	{
+		size_t steps_count = turing_machine.getStepsCount();
+		if (steps_count >= options.program_iteration_limit)
+		{
+			error_description = "Runtime error: exceed maximum iterations limit (set to " + std::to_string(options.program_iteration_limit) + ")";
+			success = false;
+			break;
+		}
+
+		size_t iterations_count = options.program_iteration_limit - steps_count;
+		if (!options.checkpoint_path.empty())
+			iterations_count = std::min(iterations_count, options.checkpoint_interval);
+
+		if (!turing_machine.execute(error_description, iterations_count, false))
+		{
+			// Cancelled execution could be continued later, so its state is saved right away
+			if (turing_machine.getLastError() == TM::ExecutionError::Cancelled && !options.checkpoint_path.empty())
+			{
+				waitCheckpointWriter();
+				if (!writeCheckpointFile(options.checkpoint_path, [&turing_machine](std::ostream &output) { turing_machine.saveCheckpoint(output); }))
+					reportCheckpointFailure(options.checkpoint_path);
+			}
+
+			success = false;
+			break;
+		}
+
+		if (options.checkpoint_path.empty())
+			continue;
+
+		waitCheckpointWriter();
+
+#ifdef TM_CHECKPOINT_FORK_SUPPORTED
+		if (startCheckpointProcess(turing_machine, options.checkpoint_path, checkpoint_process_id))
+			continue;
+#endif
+
+		std::string checkpoint_data;
+		checkpoint_data.reserve(turing_machine.getCheckpointSize());
+		{
+			StringAppendBuffer checkpoint_buffer(checkpoint_data);
+			std::ostream checkpoint_stream(&checkpoint_buffer);
+			turing_machine.saveCheckpoint(checkpoint_stream);
+		}
+
+		checkpoint_writer = std::thread([path = options.checkpoint_path, checkpoint_data = std::move(checkpoint_data)]()
+		{
+			if (!writeCheckpointFile(path, [&checkpoint_data](std::ostream &output) { output.write(checkpoint_data.data(), checkpoint_data.size()); }))
+				reportCheckpointFailure(path);
+		});
+	}
+
+	waitCheckpointWriter();
+	return success;
+}
+
+static constexpr size_t DebuggerWindowRadius = 32;
+
+static void printDebuggerPosition(const TM::TuringProgram &program, const TM::TimeTravelDebugger &debugger, const TM::Tape &tape)
+{
+	const TM::TuringMachine &turing_machine = debugger.getMachine();
+	std::string state_name = turing_machine.isHalted() ? "halt" : program.getStateName(turing_machine.getCurrentState());
+
+	// Only cells around head are printed, so output doesn't depend on tape size
+	size_t head_position = tape.getHeadPosition();
+	size_t window_begin = head_position - std::min(head_position, DebuggerWindowRadius);
+	size_t window_end = std::min(tape.size(), head_position + DebuggerWindowRadius + 1);
+	const char *leading_marker = window_begin != 0 ? "..." : "";
+	const char *trailing_marker = window_end != tape.size() ? "..." : "";
+
+	std::cout << "Step " << debugger.getCurrentStep() << ", state \"" << state_name << "\", head at " << head_position << "\n";
+	std::cout << leading_marker;
+	std::cout.write(tape.getString() + window_begin, window_end - window_begin) << trailing_marker << "\n";
+	std::cout << std::string(std::strlen(leading_marker) + head_position - window_begin, ' ') << "^\n";
+}
+
+/*
+ * Commands: step [count], back [count], goto <step>, quit. Empty line repeats "step".
+ * Timeout limits execution time of each command.
+ */
+static void executeDebugger(const TM::TuringProgram &program, const Options &options, TM::Tape &tape)
+{
+	TM::TimeTravelDebugger debugger(program, tape, options.snapshot_interval, options.snapshot_budget);
+	printDebuggerPosition(program, debugger, tape);
+
+	std::string line;
+	while (std::cout << "> " << std::flush, std::getline(std::cin, line))
+	{
+		std::istringstream command_stream(line);
+		std::string command, argument;
+		command_stream >> command >> argument;
+
+		size_t count = 1;
+		if (!argument.empty() && !parseCount(argument, count))
+		{
+			std::cout << "\"" << argument << "\" is not a valid count\n";
+			continue;
+		}
+
+		// Timeout is applied to each command, so time spent waiting for input isn't counted
+		debugger.getMachine().setLimits(makeExecutionLimits(options));
+
+		std::string error_description;
+		bool success = true;
+		if (command.empty() || command == "step" || command == "s")
+			success = debugger.stepForward(error_description, count);
+		else if (command == "back" || command == "b")
+			success = debugger.stepBackward(error_description, count);
+		else if ((command == "goto" || command == "g") && !argument.empty())
+			success = debugger.goToStep(count, error_description);
+		else if (command == "quit" || command == "q")
+			break;
+		else
+		{
+			std::cout << "Unknown command, expected: step [count], back [count], goto <step>, quit\n";
+			continue;
+		}
+
+		if (!success)
+			std::cout << error_description << "\n";
+
+		printDebuggerPosition(program, debugger, tape);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	Options options;
+	std::string error_description;
+	if (!parseOptions(argc, argv, options, error_description))
+	{
+		if (!error_description.empty())
+			std::cout << "Invalid arguments: " << error_description << "\n\n";
+
+		std::cout << UsageDescription;
+		return error_description.empty() ? 0 : -1;
+	}
+
+	if (options.server_mode)
+	{
+		ExecutionServer server(std::cin, std::cout, makeExecutionLimits(options), options.max_tape_bytes, std::chrono::milliseconds(options.timeout_milliseconds));
+		server.run(options.server_workers_count);
+
+		return 0;
+	}
+
+	const bool batch_mode = !options.batch_input_path.empty();
+	std::ostream &log = batch_mode ? std::cerr : std::cout;
+
+	std::string source_code = HelloWorldSourceCode;
+	if (!options.program_path.empty())
+	{
+		if (!loadSourceCode(options.program_path, source_code))
+		{
+			log << "Unable to load program source code" << std::endl;
+			return -1;
+		}
+
+		if (!batch_mode)
+			log << "Loaded program source code\n\n";
 	}
 
 	TM::TuringProgram program;
 	TM::ErrorInfo error_info;
-	if (!program.compile(source_code, error_info, begin_state_name))
+	if (!program.compile(source_code, error_info, options.begin_state_name))
+	{
+		log << error_info.description << std::endl;
+		return -1;
+	}
+
+	if (!options.states_order_path.empty() && !applyStatesOrderFile(program, options.states_order_path))
 	{
-		std::cout << error_info.description << std::endl;
+		log << "Unable to apply states order file" << std::endl;
 		return -1;
 	}
 
+	if (batch_mode)
+	{
+		std::ios::sync_with_stdio(false);
+		if (options.batch_input_path == "-")
+			return executeBatch(program, options, std::cin);
+
+		std::ifstream batch_input_file(options.batch_input_path);
+		if (!batch_input_file.is_open())
+		{
+			log << "Unable to open batch input file" << std::endl;
+			return -1;
+		}
+
+		return executeBatch(program, options, batch_input_file);
+	}
+
 	std::cout << "Program compilation successful!\n\n";
 
-	TM::Tape tape(default_tape_symbol, tape_initial_data);
+	TM::Tape tape(options.default_tape_symbol, options.tape_initial_data, 0, options.max_tape_bytes);
 	TM::TuringMachine turing_machine(program, tape);
 
-	std::string error_description;
-	if (!turing_machine.execute(error_description, program_iteration_limit))
-		std::cout << error_description << std::endl;
+	if (!options.tape_file_path.empty() && !tape.mapFile(options.tape_file_path, options.tape_file_size))
+	{
+		std::cout << "Unable to map tape file" << std::endl;
+		return -1;
+	}
+
+	if (options.debug_mode)
+	{
+		executeDebugger(program, options, tape);
+		return 0;
+	}
+
+	if (!options.resume_path.empty())
+	{
+		std::ifstream checkpoint_file(options.resume_path, std::ios::binary);
+		if (!checkpoint_file.is_open())
+		{
+			std::cout << "Unable to open checkpoint file" << std::endl;
+			return -1;
+		}
+
+		if (!turing_machine.loadCheckpoint(checkpoint_file, error_description))
+		{
+			std::cout << error_description << std::endl;
+			return -1;
+		}
+
+		std::cout << "Resumed from checkpoint at step " << turing_machine.getStepsCount() << "\n\n";
+	}
+
+	// Interruption cancels execution, so result tape (and checkpoint) is still available
+	std::signal(SIGINT, cancelExecution);
+	turing_machine.setLimits(makeExecutionLimits(options, &ExecutionCancelled));
+
+	std::vector<uint64_t> transitions_counts;
+	if (!options.profile_output_path.empty())
+		turing_machine.setTransitionsCounter(&transitions_counts);
+
+	if (options.checkpoint_path.empty() && options.resume_path.empty())
+	{
+		if (!turing_machine.execute(error_description, options.program_iteration_limit))
+			std::cout << error_description << std::endl;
+	}
+	else
+	{
+		if (!executeWithCheckpoints(turing_machine, options, error_description))
+			std::cout << error_description << std::endl;
+
+		std::cout << "Steps count: " << turing_machine.getStepsCount() << "\n";
+	}
+
+	if (!options.profile_output_path.empty() && !writeStatesOrderFile(program, transitions_counts, options.profile_output_path))
+		std::cout << "Unable to write states order file" << std::endl;
 
 	tape.trimRedundantSpaces();
 	std::cout << "Result tape:\n";
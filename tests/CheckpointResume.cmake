@@ -0,0 +1,71 @@
+# Interrupts execution by iterations limit twice with checkpoints enabled, resumes it and compares result with
+# uninterrupted execution, then checks that foreign, truncated and not checkpoint files are rejected.
+# Usage: cmake -DLIBTEST=<path_to_libtest> -DPROGRAMS_DIRECTORY=<path> -DWORKING_DIRECTORY=<path> -P CheckpointResume.cmake
+
+file(MAKE_DIRECTORY "${WORKING_DIRECTORY}")
+
+set(PROGRAM "${PROGRAMS_DIRECTORY}/BinaryMultiplication.tmc")
+set(TAPE_INITIAL_DATA "110101_101101")
+set(CHECKPOINT "${WORKING_DIRECTORY}/BinaryMultiplication.checkpoint")
+file(REMOVE "${CHECKPOINT}")
+
+# Returns output starting from steps count, which is printed the same way for resumed and uninterrupted executions
+function(run_libtest output_variable)
+	execute_process(
+		COMMAND "${LIBTEST}" -p "${PROGRAM}" ${ARGN}
+		OUTPUT_VARIABLE output
+		ERROR_VARIABLE output
+		RESULT_VARIABLE result
+	)
+
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "libtest ${ARGN} failed with code ${result}:\n${output}")
+	endif()
+
+	string(REGEX MATCH "Steps count:.*$" result_output "${output}")
+	set(${output_variable} "${result_output}" PARENT_SCOPE)
+endfunction()
+
+function(expect_checkpoint_error program checkpoint expected_error)
+	execute_process(
+		COMMAND "${LIBTEST}" -p "${program}" --resume "${checkpoint}"
+		OUTPUT_VARIABLE output
+		ERROR_VARIABLE output
+		RESULT_VARIABLE result
+	)
+
+	if (result EQUAL 0 OR NOT output MATCHES "Checkpoint error: ${expected_error}")
+		message(FATAL_ERROR "Checkpoint ${checkpoint} is not rejected with \"${expected_error}\" (code ${result}):\n${output}")
+	endif()
+endfunction()
+
+run_libtest(uninterrupted_output -i "${TAPE_INITIAL_DATA}" -l 100000 --checkpoint "${WORKING_DIRECTORY}/Uninterrupted.checkpoint")
+run_libtest(first_output -i "${TAPE_INITIAL_DATA}" -l 500 --checkpoint "${CHECKPOINT}" --checkpoint-interval 100)
+run_libtest(second_output --resume "${CHECKPOINT}" -l 1300 --checkpoint "${CHECKPOINT}" --checkpoint-interval 100)
+run_libtest(resumed_output --resume "${CHECKPOINT}" -l 100000)
+
+if (NOT first_output MATCHES "^Steps count: 500\n" OR NOT second_output MATCHES "^Steps count: 1300\n")
+	message(FATAL_ERROR "Execution isn't interrupted on limits:\n${first_output}\n${second_output}")
+endif()
+
+if (NOT resumed_output STREQUAL uninterrupted_output)
+	message(FATAL_ERROR "Resumed execution differs from uninterrupted one\nUninterrupted:\n${uninterrupted_output}\nResumed:\n${resumed_output}")
+endif()
+
+expect_checkpoint_error("${PROGRAMS_DIRECTORY}/PalindromeDetector.tmc" "${CHECKPOINT}" "checkpoint was created by another program")
+
+file(WRITE "${WORKING_DIRECTORY}/Text.checkpoint" "This is not a checkpoint\n")
+expect_checkpoint_error("${PROGRAM}" "${WORKING_DIRECTORY}/Text.checkpoint" "data is not a checkpoint")
+
+# Script mode can't write binary data, so truncated checkpoints are made by head where it's available
+find_program(HEAD_PROGRAM head)
+if (HEAD_PROGRAM)
+	file(READ "${CHECKPOINT}" checkpoint_data HEX)
+	string(LENGTH "${checkpoint_data}" checkpoint_hex_size)
+	math(EXPR last_truncated_size "${checkpoint_hex_size}/2 - 1")
+	foreach(truncated_size RANGE 8 ${last_truncated_size})
+		set(truncated_checkpoint "${WORKING_DIRECTORY}/Truncated.checkpoint")
+		execute_process(COMMAND "${HEAD_PROGRAM}" -c ${truncated_size} "${CHECKPOINT}" OUTPUT_FILE "${truncated_checkpoint}")
+		expect_checkpoint_error("${PROGRAM}" "${truncated_checkpoint}" "(unexpected end of data|tape data is corrupted)")
+	endforeach()
+endif()
@@ -0,0 +1,59 @@
+# Jumps back and forth in debugger with frequent snapshots and small snapshots budgets (so snapshots are merged),
+# and compares every printed position with the one reached by single goto in a new session.
+# Usage: cmake -DLIBTEST=<path_to_libtest> -DPROGRAMS_DIRECTORY=<path> -DWORKING_DIRECTORY=<path> -P DebuggerTimeTravel.cmake
+
+file(MAKE_DIRECTORY "${WORKING_DIRECTORY}")
+
+set(PROGRAM "${PROGRAMS_DIRECTORY}/BinaryMultiplication.tmc")
+set(TAPE_INITIAL_DATA "110101_101101")
+
+# Each position is printed as three lines: step, state and head, tape cells around head and caret under the head
+function(run_debugger commands positions_variable)
+	set(commands_path "${WORKING_DIRECTORY}/Commands.txt")
+	file(WRITE "${commands_path}" "${commands}")
+
+	execute_process(
+		COMMAND "${LIBTEST}" -p "${PROGRAM}" -i "${TAPE_INITIAL_DATA}" --debug ${ARGN}
+		INPUT_FILE "${commands_path}"
+		OUTPUT_VARIABLE output
+		RESULT_VARIABLE result
+	)
+
+	if (NOT result EQUAL 0)
+		message(FATAL_ERROR "Debugger failed with code ${result}:\n${output}")
+	endif()
+
+	string(REGEX MATCHALL "Step [0-9]+, [^\n]*\n[^\n]*\n[^\n]*\n" positions "${output}")
+	set(${positions_variable} "${positions}" PARENT_SCOPE)
+endfunction()
+
+# Program halts at step 2090, so "goto 3000" stops there
+set(COMMANDS "goto 1500\nback 600\ngoto 40\nstep 5\ngoto 3000\nback 2090\ngoto 1234\nback\n\ngoto 2089\nstep 10\nquit\n")
+set(EXPECTED_STEPS 0 1500 900 40 45 2090 0 1234 1233 1234 2089 2090)
+
+# Budgets are chosen so that different count of snapshots is merged, from none to all except the first and the last
+foreach(snapshot_interval 1 7)
+	foreach(snapshot_budget 100 300 1000 3000 100000)
+		run_debugger("${COMMANDS}" positions --snapshot-interval ${snapshot_interval} --snapshot-budget ${snapshot_budget})
+
+		set(steps "")
+		foreach(position IN LISTS positions)
+			string(REGEX MATCH "^Step ([0-9]+)," step_header "${position}")
+			set(step ${CMAKE_MATCH_1})
+			list(APPEND steps ${step})
+
+			if (NOT DEFINED reference_position_${step})
+				run_debugger("goto ${step}\nquit\n" reference_positions)
+				list(GET reference_positions -1 reference_position_${step})
+			endif()
+
+			if (NOT position STREQUAL reference_position_${step})
+				message(FATAL_ERROR "Position after time travel (snapshot interval ${snapshot_interval}, budget ${snapshot_budget}) differs from direct execution\nTime travel:\n${position}\nDirect:\n${reference_position_${step}}")
+			endif()
+		endforeach()
+
+		if (NOT steps STREQUAL EXPECTED_STEPS)
+			message(FATAL_ERROR "Debugger visited steps ${steps} instead of ${EXPECTED_STEPS}")
+		endif()
+	endforeach()
+endforeach()
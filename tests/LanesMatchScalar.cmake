@@ -0,0 +1,34 @@
+# Compares batch results with and without lanes on every iterations limit up to the one that is enough to halt,
+# so each input also stops exactly on the limit (including steps where the next action is missing).
+# Extra arguments of compare_lanes_with_scalar() are passed to both runs (e.g. tape cells limit, which narrows lane window).
+# Usage: cmake -DLIBTEST=<path_to_libtest> -DPROGRAMS_DIRECTORY=<path> -DWORKING_DIRECTORY=<path> -P LanesMatchScalar.cmake
+
+file(MAKE_DIRECTORY "${WORKING_DIRECTORY}")
+
+set(MISSING_ACTION_PROGRAM "${WORKING_DIRECTORY}/MissingAction.tmc")
+file(WRITE "${MISSING_ACTION_PROGRAM}" "0 a b r 1\n1 a b r 1\n")
+file(WRITE "${WORKING_DIRECTORY}/MissingAction.txt" "a\naa\naaa\nb\n\n")
+file(WRITE "${WORKING_DIRECTORY}/PalindromeDetector.txt" "1001001\n10\n0\n\n110011\n1110\n")
+
+function(compare_lanes_with_scalar program input max_limit)
+	foreach(limit RANGE 0 ${max_limit})
+		execute_process(
+			COMMAND "${LIBTEST}" -p "${program}" -l ${limit} --batch "${input}" ${ARGN}
+			OUTPUT_VARIABLE scalar_output
+		)
+		execute_process(
+			COMMAND "${LIBTEST}" -p "${program}" -l ${limit} --batch "${input}" ${ARGN} --lanes 2
+			OUTPUT_VARIABLE lanes_output
+		)
+
+		if (NOT scalar_output STREQUAL lanes_output)
+			message(FATAL_ERROR "Results of ${program} ${ARGN} differ with limit ${limit}\nScalar:\n${scalar_output}\nLanes:\n${lanes_output}")
+		endif()
+	endforeach()
+endfunction()
+
+compare_lanes_with_scalar("${MISSING_ACTION_PROGRAM}" "${WORKING_DIRECTORY}/MissingAction.txt" 5)
+compare_lanes_with_scalar("${PROGRAMS_DIRECTORY}/PalindromeDetector.tmc" "${WORKING_DIRECTORY}/PalindromeDetector.txt" 60)
+foreach(cells_limit 0 3 7 8 9 12)
+	compare_lanes_with_scalar("${PROGRAMS_DIRECTORY}/PalindromeDetector.tmc" "${WORKING_DIRECTORY}/PalindromeDetector.txt" 60 --max-tape-cells ${cells_limit})
+endforeach()